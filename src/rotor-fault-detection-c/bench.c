@@ -0,0 +1,294 @@
+/*
+  rotor_bench — stage-level timings for rotor_fd (make bench)
+  Usage: rotor_bench [--reps R] [--threads T] [--quick] [--input <capture.rfd>] [--out bench.json]
+         rotor_bench --check      (make check: consistency checks of the fast paths, exit 1 on failure)
+  Includes rotorfd.c for the stage functions and times each stage on its own: load (synthesis or
+  file read), FIR design, FIR, envelope, decimation, Welch and peak matching. Cases sweep
+  N, nperseg and taps one at a time around a base point, for float/fixed and synthetic/
+  file input. Each stage reports median and p99 over R repetitions and samples/s;
+  allocation is reported as the exact workspace, setup table and input buffer bytes.
+*/
+#include "rotorfd.c"
+
+enum { B_LOAD, B_DESIGN, B_FIR, B_ENV, B_DECIM, B_WELCH, B_PEAK, B_COUNT };
+static const char *bench_stage[B_COUNT]={ "load", "fir_design", "fir", "envelope", "decimate", "welch", "peak" };
+
+typedef struct { int N, nperseg, taps, fixed, file; } BenchCase;
+
+#define BENCH_FS 51200.0
+static const int sweep_N[]={ 51200, 204800, 819200 };
+static const int sweep_nperseg[]={ 4096, 16384, 65536 };
+static const int sweep_taps[]={ 65, 257, 1025 };
+static const BenchCase bench_base={ 204800, 65536, 257, 0, 0 };
+
+static double now_s(void){ struct timespec ts; clock_gettime(CLOCK_MONOTONIC,&ts); return ts.tv_sec + ts.tv_nsec*1e-9; }
+static int cmp_double(const void *a, const void *b){ double x=*(const double*)a, y=*(const double*)b; return (x>y)-(x<y); }
+
+/* Nearest-rank percentile of v[0..n), sorted in place. */
+static double percentile(double *v, int n, double p){
+  qsort(v,n,sizeof(double),cmp_double);
+  int r=(int)ceil(p/100.0*n); if(r<1) r=1; if(r>n) r=n;
+  return v[r-1];
+}
+
+/* Temporary int16 Q15 capture holding the synthetic signal (halved to stay in range). */
+static int write_capture(const char *path, const BearingGeom *g, int N){
+  FILE *f=fopen(path,"wb"); if(!f) return -1;
+  double *acc=(double*)malloc(sizeof(double)*N); rfd_synth(g,BENCH_FS,N,acc,NULL);
+  CaptureHeader h; memset(&h,0,sizeof(h));
+  h.magic=CAP_MAGIC; h.version=CAP_VERSION; h.header_bytes=CAP_HEADER_BYTES; h.fs_hz=BENCH_FS;
+  h.channels=1; h.sample_type=CAP_INT16; h.scale=1.0f/32768.0f; h.frames=(uint64_t)N;
+  capture_write_header(f,&h);
+  for(int i=0;i<N;i++){ int16_t s=q15_from_double(0.5*acc[i]); fwrite(&s,sizeof(s),1,f); }
+  free(acc);
+  int err=ferror(f); fclose(f);
+  return err? -1 : 0;
+}
+
+static void case_label(char *buf, size_t n, const BenchCase *c){
+  snprintf(buf,n,"%s/%s N=%d nperseg=%d taps=%d", c->fixed? "fixed" : "float", c->file? "file" : "synthetic", c->N, c->nperseg, c->taps);
+}
+
+/* Runs one case R times; t[s*R + r] gets stage s of repetition r. */
+static int bench_case(const BenchCase *c, const char *path, int reps, int threads, double *t, WsDims *dm_out, size_t *bytes){
+  Config cfg; BearingGeom g; rfd_defaults(&cfg,&g);
+  cfg.fs=BENCH_FS; cfg.duration_s=c->N/BENCH_FS; cfg.nperseg=c->nperseg; cfg.taps=c->taps; cfg.fixed=c->fixed; cfg.threads=threads;
+  WsDims dm; ws_dims(&dm,&cfg,&g,c->N); *dm_out=dm;
+  PlanCache pc; cache_init(&pc); WsTables tb; ws_tables(&tb,&pc,&cfg,&dm);
+  Workspace ws={NULL,0}; WsLayout L;
+  double *h=(double*)malloc(sizeof(double)*c->taps); q15 *hq=(q15*)malloc(sizeof(q15)*c->taps);
+  double *acc=c->file? NULL : (double*)malloc(sizeof(double)*c->N);
+  bytes[0]=ws_bytes(&dm); bytes[1]=cache_bytes(&pc,1); bytes[2]=c->file && c->fixed? 0 : sizeof(double)*(size_t)c->N;
+  ParPool *pool=par_pool_create(threads); par_pool=pool;  // as a context runs its windows
+  int rc=0;
+  for(int r=0;r<reps && rc==0;r++){
+    ws_prepare(&ws,&L,&dm);                               // fresh decimator state per run
+    double t0=now_s();
+    Capture cap; const q15 *xq=NULL;
+    if(c->file){
+      if(capture_open(path,&cap)!=0 || (int)cap.hdr.frames!=c->N){ fprintf(stderr,"bench: cannot read %s\n", path); rc=1; break; }
+      if(c->fixed && cap.hdr.sample_type==CAP_INT16 && cap.hdr.channels==1 && cap.hdr.scale==1.0f/32768.0f) xq=(const q15*)cap.samples;
+      else { double *tach=NULL; capture_to_double(&cap,&acc,&tach); free(tach); }
+    } else rfd_synth(&g,cfg.fs,c->N,acc,NULL);
+    double t1=now_s();
+    fir_bandpass(h,c->taps,cfg.fs,cfg.band_lo,cfg.band_hi);
+    if(c->fixed) for(int i=0;i<c->taps;i++) hq[i]=q15_from_double(h[i]);
+    double t2=now_s(); Perf pf; perf_start(&pf);
+    dsp_run(&cfg,&dm,&tb,&L,acc,xq,&pf);
+    double t3=now_s();
+    Detections det; peak_table_build(&L.peaks,L.f_hz,L.P_hz,dm.Kd); detect_hz(&g,&L.peaks,&det);
+    double t4=now_s();
+    t[B_LOAD*reps+r]=t1-t0; t[B_DESIGN*reps+r]=t2-t1;
+    t[B_FIR*reps+r]=pf.s[PF_FIR]; t[B_ENV*reps+r]=pf.s[PF_ENV]; t[B_DECIM*reps+r]=pf.s[PF_DECIM]; t[B_WELCH*reps+r]=pf.s[PF_WELCH];
+    t[B_PEAK*reps+r]=t4-t3;
+    if(c->file){ capture_close(&cap); free(acc); acc=NULL; }
+  }
+  par_pool=NULL; par_pool_destroy(pool);
+  free(h); free(hq); free(acc); ws_free(&ws); cache_free(&pc);
+  return rc;
+}
+
+/* ---------------- --check ----------------
+   Each fast path against a direct computation of the same quantity. */
+
+/* The pre-table detector: every bin tested as a local maximum, ring summed in place. */
+static PeakHit scan_peak(const double *f, const double *P, int K, double target, double tol_rel, double min_snr_db){
+  PeakHit h={0,0,0,0,0,0}; if(target<=0) return h;
+  double best=-1; int bi=-1;
+  for(int i=1;i<K-1;i++) if(P[i]>P[i-1] && P[i]>P[i+1] && fabs(f[i]-target)/target<=tol_rel && P[i]>best){ best=P[i]; bi=i; }
+  if(bi<0) return h;
+  int lo=bi-DET_RING_BINS, hi=bi+DET_RING_BINS; if(lo<0) lo=0; if(hi>=K) hi=K-1;
+  double sum=0.0; int cnt=0;
+  for(int i=lo;i<=hi;i++) if(i<bi-DET_GUARD || i>bi+DET_GUARD){ sum+=P[i]; cnt++; }
+  double noise=cnt>0? sum/cnt : 1e-20; if(noise<1e-20) noise=1e-20;
+  h.index=bi; h.freq=f[bi]; h.snr_db=10.0*log10(P[bi]/noise); h.df=f[1]-f[0]; h.found=h.snr_db>=min_snr_db;
+  return h;
+}
+
+static int same_hit(const PeakHit *a, const PeakHit *b){
+  return a->found==b->found && a->index==b->index && a->freq==b->freq && a->harmonic==b->harmonic && fabs(a->snr_db-b->snr_db)<=1e-6;
+}
+
+/* detect_hz's lines and harmonic fallback over scan_peak. */
+static void scan_detect(const BearingGeom *g, const double *f, const double *P, int K, PeakHit hit[4]){
+  double line[4]={ bpfo_hz(g), bpfi_hz(g), bsf_hz(g), ftf_hz(g) };
+  for(int k=0;k<4;k++){
+    hit[k]=scan_peak(f,P,K,line[k],DET_TOL_REL,6.0);
+    for(int H=2;k<2 && !hit[k].found && H<=DET_MAX_HARMONIC;H++){ PeakHit t=scan_peak(f,P,K,H*line[k],DET_TOL_REL,6.0); if(t.found){ t.harmonic=H; hit[k]=t; } }
+  }
+}
+
+/* peak_query and detect_hz against scan_peak on the synthetic capture, with and without
+   envelope decimation: targets on every peak, halfway between neighbours, on a log sweep
+   past both ends of the spectrum and at the edge bins, over a range of tolerances and
+   with and without the SNR cut; then the detector over a range of shaft speeds. */
+static int check_peaks(void){
+  int fails=0;
+  const double tols[]={ 0.0, 1e-4, 0.005, DET_TOL_REL, 0.1, 0.5 }, snrs[]={ 6.0, -1e9 };
+  for(int dec=0;dec<2;dec++){
+    Config cfg; BearingGeom g; rfd_defaults(&cfg,&g); cfg.threads=1; cfg.decimate=dec? 0 : 1;
+    int N=(int)(cfg.fs*cfg.duration_s);
+    WsDims dm; ws_dims(&dm,&cfg,&g,N);
+    PlanCache pc; cache_init(&pc); WsTables tb; ws_tables(&tb,&pc,&cfg,&dm);
+    Workspace ws={NULL,0}; WsLayout L; ws_prepare(&ws,&L,&dm);
+    double *acc=(double*)malloc(sizeof(double)*N); rfd_synth(&g,cfg.fs,N,acc,NULL);
+    dsp_run(&cfg,&dm,&tb,&L,acc,NULL,NULL);
+    const double *f=L.f_hz, *P=L.P_hz; int K=dm.Kd;
+    peak_table_build(&L.peaks,f,P,K); const PeakTable *t=&L.peaks;
+
+    int nt=0, cap=2*t->npk+2000+16; double *tg=(double*)malloc(sizeof(double)*cap);
+    for(int j=0;j<t->npk;j++){ tg[nt++]=f[t->pk[j]]; if(j+1<t->npk) tg[nt++]=0.5*(f[t->pk[j]]+f[t->pk[j+1]]); }
+    for(int i=0;i<2000;i++) tg[nt++]=0.25*f[1]*pow(4.0*f[K-1]/f[1], i/1999.0);
+    double edge[]={ -1.0, 0.0, f[1], f[2], 0.5*f[1], f[K-3], f[K-2], f[K-1], 1.01*f[K-1], 1.5*f[K-1] };
+    for(size_t i=0;i<sizeof(edge)/sizeof(edge[0]);i++) tg[nt++]=edge[i];
+    long queries=0, bad=0;
+    for(int i=0;i<nt;i++) for(size_t a=0;a<sizeof(tols)/sizeof(tols[0]);a++) for(int b=0;b<2;b++){
+      PeakHit q=peak_query(t,tg[i],tols[a],snrs[b]), r=scan_peak(f,P,K,tg[i],tols[a],snrs[b]);
+      queries++;
+      if(!same_hit(&q,&r)){ if(bad++<3) printf("      target %.6g Hz tol %g: table bin %d (%.3f dB) scan bin %d (%.3f dB)\n", tg[i], tols[a], q.index, q.snr_db, r.index, r.snr_db); }
+    }
+    int speeds=0;
+    for(double rpm=300.0; rpm<=6000.0; rpm+=47.5){
+      BearingGeom gs=g; gs.rpm=rpm; Detections d; PeakHit r[4];
+      detect_hz(&gs,t,&d); scan_detect(&gs,f,P,K,r); speeds++;
+      const PeakHit *q[4]={ &d.hz_bpfo, &d.hz_bpfi, &d.hz_bsf, &d.hz_ftf };
+      for(int k=0;k<4;k++) if(!same_hit(q[k],&r[k])){ if(bad++<3) printf("      detect at %.1f rpm, line %d: table bin %d scan bin %d\n", rpm, k, q[k]->index, r[k].index); }
+    }
+    int ok=bad==0; fails+=!ok;
+    printf("%s  peak queries, decimation %d: %d peaks, %ld queries and %d detector runs against a full scan, %ld differ\n",
+           ok? "ok  " : "FAIL", dm.D, t->npk, queries, speeds, bad);
+    free(tg); free(acc); ws_free(&ws); cache_free(&pc);
+  }
+  return fails;
+}
+
+/* Gate features from the int16 Q15 path against the double path on the same capture:
+   Gaussian noise with sparse impacts (kurtosis well above 3) and a small DC offset, from
+   rms 0.3 down to 1e-3 (about 33 LSB), within 1%. */
+static int check_gate(void){
+  const int N=1<<18; const double levels[]={ 0.3, 0.1, 0.03, 0.01, 3e-3, 1e-3 };
+  double *x=(double*)malloc(sizeof(double)*N); q15 *xq=(q15*)malloc(sizeof(q15)*N);
+  int fails=0;
+  for(size_t l=0;l<sizeof(levels)/sizeof(levels[0]);l++){
+    double a=levels[l]; uint64_t st=0x9e3779b97f4a7c15ull+l;
+    for(int i=0;i<N;i+=2){
+      double u1, u2;
+      st=st*6364136223846793005ull+1442695040888963407ull; u1=((st>>11)+0.5)*(1.0/9007199254740992.0);
+      st=st*6364136223846793005ull+1442695040888963407ull; u2=((st>>11)+0.5)*(1.0/9007199254740992.0);
+      double r=a*sqrt(-2.0*log(u1));
+      x[i]=0.05*a + r*cos(2*M_PI*u2); if(i+1<N) x[i+1]=0.05*a + r*sin(2*M_PI*u2);
+    }
+    for(int i=0;i<N;i+=997) x[i]+=(i&1? -6.0 : 6.0)*a;
+    for(int i=0;i<N;i++){ xq[i]=q15_from_double(x[i]); x[i]=xq[i]/32768.0; }
+    double fd[GATE_NF], fq[GATE_NF], worst=0.0;
+    gate_features(x,NULL,N,fd); gate_features(NULL,xq,N,fq);
+    for(int k=0;k<GATE_NF;k++){ double d=fabs(fq[k]-fd[k])/fabs(fd[k]); if(d>worst) worst=d; }
+    int ok=worst<=0.01; fails+=!ok;
+    printf("%s  gate Q15 vs double, rms %-6g: kurtosis %.3f / %.3f, max rel. diff %.3g\n", ok? "ok  " : "FAIL", a, fq[3], fd[3], worst);
+  }
+  free(x); free(xq);
+  return fails;
+}
+
+/* Float and fixed PSDs with 4 threads on a worker pool against short-lived threads:
+   same chunks, so the same bits. */
+static int check_pool(void){
+  int fails=0;
+  for(int fixed=0;fixed<2;fixed++){
+    Config cfg; BearingGeom g; rfd_defaults(&cfg,&g); cfg.threads=4; cfg.fixed=fixed;
+    int N=(int)(cfg.fs*cfg.duration_s);
+    WsDims dm; ws_dims(&dm,&cfg,&g,N);
+    PlanCache pc; cache_init(&pc); WsTables tb; ws_tables(&tb,&pc,&cfg,&dm);
+    Workspace ws={NULL,0}; WsLayout L;
+    double *acc=(double*)malloc(sizeof(double)*N), *P=(double*)malloc(sizeof(double)*dm.Kd); rfd_synth(&g,cfg.fs,N,acc,NULL);
+    ws_prepare(&ws,&L,&dm); dsp_run(&cfg,&dm,&tb,&L,acc,NULL,NULL); memcpy(P,L.P_hz,sizeof(double)*dm.Kd);
+    ParPool *pool=par_pool_create(cfg.threads); par_pool=pool;
+    ws_prepare(&ws,&L,&dm); dsp_run(&cfg,&dm,&tb,&L,acc,NULL,NULL);
+    par_pool=NULL;
+    int ok=pool && memcmp(P,L.P_hz,sizeof(double)*dm.Kd)==0; fails+=!ok;
+    printf("%s  %s PSD, 4 threads: worker pool %s short-lived threads\n", ok? "ok  " : "FAIL", fixed? "fixed" : "float", ok? "==" : "!=");
+    par_pool_destroy(pool); free(acc); free(P); ws_free(&ws); cache_free(&pc);
+  }
+  return fails;
+}
+
+static int run_checks(void){
+  int fails=check_peaks() + check_gate() + check_pool();
+  printf("%s\n", fails? "check: FAILED" : "check: all passed");
+  return fails? 1 : 0;
+}
+
+static int add_case(BenchCase *list, int n, BenchCase c){
+  for(int i=0;i<n;i++) if(memcmp(&list[i],&c,sizeof(c))==0) return n;
+  list[n]=c; return n+1;
+}
+
+int main(int argc, char **argv){
+  int reps=15, threads=1, quick=0; const char *outp="bench.json", *input=NULL;
+  for(int i=1;i<argc;i++){
+    if(strcmp(argv[i],"--reps")==0 && i+1<argc){ reps=atoi(argv[++i]); if(reps<1) reps=1; }
+    else if(strcmp(argv[i],"--threads")==0 && i+1<argc){ threads=atoi(argv[++i]); if(threads<1) threads=1; }
+    else if(strcmp(argv[i],"--quick")==0) quick=1;
+    else if(strcmp(argv[i],"--input")==0 && i+1<argc) input=argv[++i];
+    else if(strcmp(argv[i],"--out")==0 && i+1<argc) outp=argv[++i];
+    else if(strcmp(argv[i],"--check")==0){ q15k_select(Q15K_AUTO); return run_checks(); }
+    else { fprintf(stderr,"usage: rotor_bench [--reps R] [--threads T] [--quick] [--input <capture.rfd>] [--out bench.json] | --check\n"); return 2; }
+  }
+  q15k_select(Q15K_AUTO);
+  if(quick && reps>5) reps=5;
+  int nsweep=quick? 2 : 3;
+
+  // --input replaces the generated file cases with one capture at its own length
+  int file_N=0; char tmp[]="/tmp/rotor_fd_benchXXXXXX"; int have_tmp=0;
+  if(input){
+    Capture cap; if(capture_open(input,&cap)!=0){ fprintf(stderr,"bench: %s is not a binary capture (see csv2bin)\n", input); return 1; }
+    file_N=(int)cap.hdr.frames; capture_close(&cap);
+  }
+
+  BenchCase cases[64]; int nc=0;
+  for(int fixed=0; fixed<2; fixed++) for(int file=0; file<2; file++){
+    BenchCase b=bench_base; b.fixed=fixed; b.file=file;
+    if(file && input){ b.N=file_N; nc=add_case(cases,nc,b); continue; }
+    for(int k=0;k<nsweep;k++){ BenchCase c=b; c.N=sweep_N[k]; nc=add_case(cases,nc,c); }
+    if(file) continue;                                    // file input only changes the load stage
+    for(int k=0;k<nsweep;k++){ BenchCase c=b; c.nperseg=sweep_nperseg[3-nsweep+k]; nc=add_case(cases,nc,c); }
+    for(int k=0;k<nsweep;k++){ BenchCase c=b; c.taps=sweep_taps[k]; nc=add_case(cases,nc,c); }
+  }
+
+  FILE *out=fopen(outp,"wb"); if(!out){ fprintf(stderr,"bench: cannot open %s\n", outp); return 1; }
+  fprintf(out,"{\n  \"bench\": {\"reps\": %d, \"threads\": %d, \"simd\": \"%s\", \"fs_hz\": %.1f},\n  \"cases\": [\n",
+          reps, threads, q15k->name, BENCH_FS);
+  double *t=(double*)malloc(sizeof(double)*B_COUNT*reps);
+  int written_N=0, rc=0;
+  for(int i=0;i<nc && rc==0;i++){
+    const BenchCase *c=&cases[i]; const char *path=input;
+    if(c->file && !input){
+      if(!have_tmp){ int fd=mkstemp(tmp); if(fd<0){ perror("bench: mkstemp"); rc=1; break; } close(fd); have_tmp=1; }
+      if(written_N!=c->N){
+        Config dc; BearingGeom g; rfd_defaults(&dc,&g);
+        if(write_capture(tmp,&g,c->N)!=0){ fprintf(stderr,"bench: cannot write %s\n", tmp); rc=1; break; }
+        written_N=c->N;
+      }
+      path=tmp;
+    }
+    WsDims dm; size_t bytes[3];
+    if(bench_case(c,path,reps,threads,t,&dm,bytes)!=0){ rc=1; break; }
+    char label[128]; case_label(label,sizeof(label),c);
+    double total=0.0;
+    fprintf(out,"    {\"path\": \"%s\", \"input\": \"%s\", \"N\": %d, \"nperseg\": %d, \"taps\": %d, \"decimation\": %d, \"welch_points\": %d,\n",
+            c->fixed? "fixed" : "float", c->file? "file" : "synthetic", c->N, c->nperseg, c->taps, dm.D, dm.nd);
+    fprintf(out,"     \"bytes\": {\"workspace\": %zu, \"setup_tables\": %zu, \"input\": %zu},\n     \"stages\": {", bytes[0], bytes[1], bytes[2]);
+    for(int s=0;s<B_COUNT;s++){
+      double *v=t+(size_t)s*reps, med=percentile(v,reps,50.0), p99=percentile(v,reps,99.0);
+      total+=med;
+      fprintf(out,"%s\n       \"%s\": {\"median_ms\": %.4f, \"p99_ms\": %.4f, \"samples_per_s\": %.4e}", s? "," : "",
+              bench_stage[s], med*1e3, p99*1e3, med>0.0? c->N/med : 0.0);
+    }
+    fprintf(out,"},\n     \"total_median_ms\": %.4f, \"samples_per_s\": %.4e}%s\n", total*1e3, total>0.0? c->N/total : 0.0, i+1<nc? "," : "");
+    fprintf(stderr,"%-52s %9.3f ms  %.3e samples/s\n", label, total*1e3, total>0.0? c->N/total : 0.0);
+  }
+  fprintf(out,"  ]\n}\n");
+  fclose(out); free(t);
+  if(have_tmp) remove(tmp);
+  return rc;
+}
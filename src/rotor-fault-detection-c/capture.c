@@ -0,0 +1,231 @@
+/*
+  capture.c — binary capture mapping, fast CSV tokenizer, streaming sample reader
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "capture.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CAP_HAVE_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#define CAP_HAVE_MMAP 0
+#endif
+
+/* Whole-file read-only view: mmap where available, one fread otherwise. */
+static void *map_file(const char *path, size_t *len){
+#if CAP_HAVE_MMAP
+  int fd=open(path,O_RDONLY); if(fd<0) return NULL;
+  struct stat st; if(fstat(fd,&st)!=0){ close(fd); return NULL; }
+  *len=(size_t)st.st_size;
+  void *p = *len? mmap(NULL,*len,PROT_READ,MAP_PRIVATE,fd,0) : NULL;
+  close(fd);
+  if(p==MAP_FAILED) return NULL;
+  if(p) posix_madvise(p,*len,POSIX_MADV_SEQUENTIAL);
+  return p;
+#else
+  FILE *f=fopen(path,"rb"); if(!f) return NULL;
+  fseek(f,0,SEEK_END); long n=ftell(f); fseek(f,0,SEEK_SET);
+  void *p = n>0? malloc((size_t)n) : NULL;
+  if(p && fread(p,1,(size_t)n,f)!=(size_t)n){ free(p); p=NULL; }
+  fclose(f); *len=(size_t)(n>0? n : 0);
+  return p;
+#endif
+}
+
+static void unmap_file(void *p, size_t len){
+  if(!p) return;
+#if CAP_HAVE_MMAP
+  munmap(p,len);
+#else
+  (void)len; free(p);
+#endif
+}
+
+static int header_valid(const CaptureHeader *h){
+  return h->magic==CAP_MAGIC && h->version==CAP_VERSION && h->header_bytes>=CAP_HEADER_BYTES
+      && (h->channels==1 || h->channels==2) && (h->sample_type==CAP_INT16 || h->sample_type==CAP_FLOAT32)
+      && h->fs_hz>0.0;
+}
+
+static size_t sample_bytes(const CaptureHeader *h){ return h->sample_type==CAP_INT16? 2 : 4; }
+
+int capture_open(const char *path, Capture *c){
+  memset(c,0,sizeof(*c));
+  size_t len=0; void *p=map_file(path,&len);
+  if(!p) return -1;
+  if(len<CAP_HEADER_BYTES){ unmap_file(p,len); return -2; }
+  memcpy(&c->hdr,p,sizeof(CaptureHeader));
+  if(c->hdr.magic!=CAP_MAGIC){ unmap_file(p,len); return -2; }
+  if(!header_valid(&c->hdr)){ unmap_file(p,len); return -1; }
+  size_t frame=sample_bytes(&c->hdr)*c->hdr.channels;
+  uint64_t avail=(len - c->hdr.header_bytes)/frame;
+  if(c->hdr.frames==0 || c->hdr.frames>avail) c->hdr.frames=avail;   // tolerate truncated / streamed files
+  c->map=p; c->map_len=len; c->samples=(const char*)p + c->hdr.header_bytes;
+  return 0;
+}
+
+void capture_close(Capture *c){ unmap_file(c->map,c->map_len); memset(c,0,sizeof(*c)); }
+
+int capture_write_header(FILE *f, const CaptureHeader *h){
+  return fwrite(h,sizeof(*h),1,f)==1 ? 0 : -1;
+}
+
+void capture_to_double(const Capture *c, double **acc, double **tach){
+  size_t N=(size_t)c->hdr.frames;
+  double *a=(double*)malloc(sizeof(double)*(N? N : 1)), *t=(c->hdr.channels==2)? (double*)malloc(sizeof(double)*(N? N : 1)) : NULL;
+  for(size_t i=0;i<N;i++){ a[i]=capture_sample(c,i,0); if(t) t[i]=capture_sample(c,i,1); }
+  *acc=a; *tach=t;
+}
+
+/* ---------------- CSV tokenizer ---------------- */
+static const double pow10_exact[23]={
+  1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22 };
+
+/* One decimal number at *pp (leading blanks skipped). Significands below 2^53 with
+   |exp| <= 22 take the exact fast path (one correctly rounded mul/div); anything else
+   goes through strtod. Returns 0 and leaves *pp untouched if no number is present. */
+static int parse_num(const char **pp, const char *end, double *out){
+  const char *p=*pp;
+  while(p<end && (*p==' ' || *p=='\t')) p++;
+  const char *start=p; int neg=0;
+  if(p<end && (*p=='-' || *p=='+')){ neg=(*p=='-'); p++; }
+  uint64_t m=0; int digits=0, exp10=0, any=0;
+  while(p<end && (unsigned)(*p-'0')<10){ if(digits<19){ m=m*10+(uint64_t)(*p-'0'); if(m) digits++; } else exp10++; p++; any=1; }
+  if(p<end && *p=='.'){
+    p++;
+    while(p<end && (unsigned)(*p-'0')<10){ if(digits<19){ m=m*10+(uint64_t)(*p-'0'); if(m) digits++; exp10--; } p++; any=1; }
+  }
+  if(!any) return 0;
+  if(p<end && (*p=='e' || *p=='E')){
+    const char *q=p+1; int eneg=0, e=0, edig=0;
+    if(q<end && (*q=='-' || *q=='+')){ eneg=(*q=='-'); q++; }
+    while(q<end && (unsigned)(*q-'0')<10){ if(e<10000) e=e*10+(*q-'0'); q++; edig=1; }
+    if(edig){ exp10 += eneg? -e : e; p=q; }
+  }
+  double v;
+  if(m < (1ULL<<53) && exp10>=-22 && exp10<=22){
+    v = exp10<0 ? (double)m / pow10_exact[-exp10] : (double)m * pow10_exact[exp10];
+    if(neg) v=-v;
+  } else {
+    char tmp[128]; size_t n=(size_t)(p-start); if(n>=sizeof(tmp)) n=sizeof(tmp)-1;
+    memcpy(tmp,start,n); tmp[n]='\0'; v=strtod(tmp,NULL);
+  }
+  *out=v; *pp=p;
+  return 1;
+}
+
+/* Parses "acc[,tach]" from [p,end). Returns the number of values (0, 1 or 2). */
+static int parse_row(const char *p, const char *end, double *a, double *t){
+  if(!parse_num(&p,end,a)) return 0;
+  while(p<end && (*p==' ' || *p=='\t')) p++;
+  if(p<end && *p==','){ p++; if(parse_num(&p,end,t)) return 2; }
+  return 1;
+}
+
+static int line_blank(const char *p, const char *end){
+  for(; p<end; p++) if(*p!=' ' && *p!='\t' && *p!='\r') return 0;
+  return 1;
+}
+
+int csv_load(const char *path, double **acc, double **tach, int *N){
+  size_t len=0; char *buf=(char*)map_file(path,&len);
+  if(!buf && len) return -1;
+  if(!buf){ FILE *f=fopen(path,"rb"); if(!f) return -1; fclose(f); }   // empty but readable
+  const char *p=buf, *end=buf+len;
+  size_t lines=1; for(const char *q=p; q && q<end; ){ q=memchr(q,'\n',(size_t)(end-q)); if(q){ lines++; q++; } }
+  double *a=(double*)malloc(sizeof(double)*lines), *t=(double*)malloc(sizeof(double)*lines);
+  int n=0, cols=0;
+  while(p<end){
+    const char *eol=memchr(p,'\n',(size_t)(end-p)); if(!eol) eol=end;
+    if(!line_blank(p,eol)){
+      double v1, v2; int r=parse_row(p,eol,&v1,&v2);
+      if(r==0){ if(n>0) break; }                    // header line before the data, else end of data
+      else { a[n]=v1; t[n]=(r==2)? v2 : NAN; n++; if(r==2) cols=2; else if(cols==0) cols=1; }
+    }
+    p=eol+1;
+  }
+  unmap_file(buf,len);
+  *acc=a; *tach=(cols==2? t : NULL); *N=n; if(cols!=2) free(t);
+  return 0;
+}
+
+/* ---------------- Streaming reader ---------------- */
+#define READER_BUF (1<<16)
+
+static void reader_fill(SampleReader *r){
+  if(r->eof) return;
+  if(r->pos>0){ memmove(r->buf, r->buf+r->pos, r->len-r->pos); r->len-=r->pos; r->pos=0; }
+  size_t got=fread(r->buf+r->len, 1, READER_BUF-r->len, r->f);
+  r->len+=got;
+  if(got==0) r->eof=1;
+}
+
+int reader_open(SampleReader *r, FILE *f){
+  memset(r,0,sizeof(*r)); r->f=f; r->buf=(char*)malloc(READER_BUF);
+  if(!r->buf) return -1;
+  while(!r->eof && r->len<CAP_HEADER_BYTES) reader_fill(r);
+  if(r->len>=CAP_HEADER_BYTES){
+    CaptureHeader h; memcpy(&h,r->buf,sizeof(h));
+    if(h.magic==CAP_MAGIC){
+      if(!header_valid(&h)) return -2;
+      r->binary=1; r->hdr=h; r->pos=h.header_bytes<=r->len? h.header_bytes : r->len;
+    }
+  }
+  return 0;
+}
+
+int reader_read(SampleReader *r, double *acc, double *tach, int max){
+  int n=0;
+  if(r->binary){
+    size_t sb=sample_bytes(&r->hdr), frame=sb*r->hdr.channels;
+    while(n<max){
+      if(r->len-r->pos<frame){ reader_fill(r); if(r->len-r->pos<frame) break; }
+      size_t avail=(r->len-r->pos)/frame; if(avail>(size_t)(max-n)) avail=(size_t)(max-n);
+      const char *p=r->buf+r->pos;
+      for(size_t i=0;i<avail;i++,n++,p+=frame){
+        double v[2]={0};
+        for(unsigned c=0;c<r->hdr.channels;c++){
+          if(sb==2){ int16_t s; memcpy(&s,p+c*2,2); v[c]=s*(double)r->hdr.scale; }
+          else     { float s;   memcpy(&s,p+c*4,4); v[c]=s; }
+        }
+        acc[n]=v[0]; if(tach) tach[n]=(r->hdr.channels==2)? v[1] : NAN;
+      }
+      r->pos+=avail*frame;
+    }
+    return n;
+  }
+  while(n<max){
+    const char *p=r->buf+r->pos, *end=r->buf+r->len;
+    const char *eol=memchr(p,'\n',(size_t)(end-p));
+    if(!eol){
+      if(!r->eof && !(r->pos==0 && r->len==READER_BUF)){ reader_fill(r); continue; }
+      if(p==end) break;
+      eol=end;                                     // last line without newline
+    }
+    double v1, v2; int k=line_blank(p,eol)? 0 : parse_row(p,eol,&v1,&v2);
+    if(k>0){ acc[n]=v1; if(tach) tach[n]=(k==2)? v2 : NAN; n++; }
+    r->pos=(size_t)(eol-r->buf) + (eol<end);
+  }
+  return n;
+}
+
+void reader_close(SampleReader *r){ free(r->buf); r->buf=NULL; }
+
+/* ---------------- Window packets ---------------- */
+int packet_parse(const void *buf, size_t len, PodPacket *h, const int16_t **samples){
+  if(len<PKT_HEADER_BYTES) return -1;
+  memcpy(h,buf,sizeof(*h));
+  if(h->magic!=PKT_MAGIC || h->version!=PKT_VERSION || h->header_bytes<PKT_HEADER_BYTES || (h->header_bytes&1)) return -1;
+  if(h->n==0 || h->n>PKT_MAX_SAMPLES || !(h->fs_hz>0.0f && h->fs_hz<=PKT_MAX_FS) || !(h->scale>0.0f && isfinite(h->scale))) return -1;
+  if((size_t)h->header_bytes + 2u*h->n > len) return -1;
+  *samples=(const int16_t*)((const char*)buf + h->header_bytes);
+  return 0;
+}
@@ -0,0 +1,101 @@
+/*
+  capture.h — sample input for rotor_fd
+  - Native binary capture (.rfd): 64-byte header + interleaved frames, mapped read-only
+  - Fast CSV tokenizer for the legacy text path (acc or acc,tach per line)
+  - Block reader for --stream that accepts either format on stdin / a FIFO
+  - Window packets for --serve: 40-byte header + int16 samples, one datagram each
+*/
+#ifndef ROTOR_FD_CAPTURE_H
+#define ROTOR_FD_CAPTURE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define CAP_MAGIC        0x43444652u   // "RFDC" as little-endian u32
+#define CAP_VERSION      1
+#define CAP_HEADER_BYTES 64
+
+enum { CAP_INT16=1, CAP_FLOAT32=2 };
+
+typedef struct {
+  uint32_t magic;         // CAP_MAGIC
+  uint16_t version;       // CAP_VERSION
+  uint16_t header_bytes;  // offset of the first frame
+  double   fs_hz;
+  uint32_t channels;      // 1 = acc, 2 = acc,tach (interleaved)
+  uint32_t sample_type;   // CAP_INT16 (ADC counts) or CAP_FLOAT32
+  float    scale;         // physical = raw*scale (int16); 1.0 for float32
+  uint32_t pod_id;
+  uint64_t frames;        // samples per channel
+  uint8_t  reserved[24];
+} CaptureHeader;
+
+_Static_assert(sizeof(CaptureHeader)==CAP_HEADER_BYTES, "CaptureHeader must be 64 bytes");
+
+typedef struct {
+  CaptureHeader hdr;
+  const void   *samples;  // first frame, inside the mapping
+  void         *map;      // internal
+  size_t        map_len;  // internal
+} Capture;
+
+/* 0 on success, -1 on I/O error, -2 if the file is not a binary capture. */
+int  capture_open(const char *path, Capture *c);
+void capture_close(Capture *c);
+int  capture_write_header(FILE *f, const CaptureHeader *h);
+/* Deinterleave into physical-unit doubles (malloc'd; *tach NULL for 1 channel). */
+void capture_to_double(const Capture *c, double **acc, double **tach);
+
+static inline double capture_sample(const Capture *c, size_t frame, unsigned ch){
+  size_t i = frame*c->hdr.channels + ch;
+  if(c->hdr.sample_type==CAP_INT16) return ((const int16_t*)c->samples)[i] * (double)c->hdr.scale;
+  return ((const float*)c->samples)[i];
+}
+
+/* Legacy CSV: whole file in one pass, arrays sized from the line count (no realloc).
+   *tach is NULL unless at least one row has two columns. */
+int  csv_load(const char *path, double **acc, double **tach, int *N);
+
+/* Block reader for streaming; detects the binary header on the first bytes. */
+typedef struct {
+  FILE         *f;
+  int           binary;
+  CaptureHeader hdr;
+  char         *buf;
+  size_t        len, pos;
+  int           eof;
+} SampleReader;
+
+int  reader_open(SampleReader *r, FILE *f);
+int  reader_read(SampleReader *r, double *acc, double *tach, int max);   // tach may be NULL
+void reader_close(SampleReader *r);
+
+/* Window packet (pod -> gateway, UDP or Unix datagram). A pod numbers its packets; the
+   gateway cuts each pod's sample stream into windows and drops a partial window on a gap. */
+#define PKT_MAGIC        0x50444652u   // "RFDP" as little-endian u32
+#define PKT_VERSION      1
+#define PKT_HEADER_BYTES 40
+#define PKT_MAX_SAMPLES  8192          // 16 KiB payload: fits a default Unix datagram
+#define PKT_MAX_FS       1e6           // highest accepted sampling rate [Hz]
+
+typedef struct {
+  uint32_t magic;         // PKT_MAGIC
+  uint16_t version;       // PKT_VERSION
+  uint16_t header_bytes;  // offset of the first sample
+  uint32_t pod_id;
+  uint32_t seq;           // +1 per packet from a pod
+  uint64_t t_us;          // first sample, pod clock (us since the epoch)
+  float    fs_hz;
+  float    scale;         // physical = raw*scale
+  uint16_t n;             // int16 samples after the header
+  uint16_t flags;         // reserved (0)
+  uint32_t reserved;
+} PodPacket;
+
+_Static_assert(sizeof(PodPacket)==PKT_HEADER_BYTES, "PodPacket must be 40 bytes");
+
+/* Validates a received datagram; 0 with *h and *samples set, -1 if malformed. */
+int  packet_parse(const void *buf, size_t len, PodPacket *h, const int16_t **samples);
+
+#endif
@@ -0,0 +1,59 @@
+/*
+  csv2bin — convert a rotor_fd CSV capture (acc or acc,tach) to the binary .rfd format
+  Usage: csv2bin <in.csv> <out.rfd> [--fs <Hz>] [--type int16|float32] [--scale <s>] [--pod <id>]
+  int16 stores ADC counts: raw = round(value/scale), saturated; the default scale 1/32768
+  maps [-1,1) to full-scale Q15, which rotor_fd --fixed consumes without conversion.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "capture.h"
+
+static void usage(void){
+  fprintf(stderr,"usage: csv2bin <in.csv> <out.rfd> [--fs <Hz>] [--type int16|float32] [--scale <s>] [--pod <id>]\n");
+}
+
+int main(int argc, char **argv){
+  if(argc<3){ usage(); return 2; }
+  const char *in=argv[1], *outp=argv[2];
+  double fs=51200.0, scale=1.0/32768.0; int type=CAP_INT16; unsigned pod=0;
+  for(int i=3;i<argc;i++){
+    if(strcmp(argv[i],"--fs")==0 && i+1<argc) fs=atof(argv[++i]);
+    else if(strcmp(argv[i],"--type")==0 && i+1<argc){ const char *t=argv[++i]; type=strcmp(t,"float32")==0? CAP_FLOAT32 : CAP_INT16; }
+    else if(strcmp(argv[i],"--scale")==0 && i+1<argc) scale=atof(argv[++i]);
+    else if(strcmp(argv[i],"--pod")==0 && i+1<argc) pod=(unsigned)strtoul(argv[++i],NULL,0);
+    else { usage(); return 2; }
+  }
+  if(fs<=0.0 || scale<=0.0){ usage(); return 2; }
+
+  double *acc=NULL, *tach=NULL; int N=0;
+  if(csv_load(in,&acc,&tach,&N)!=0){ fprintf(stderr,"Failed to read %s\n", in); return 1; }
+  FILE *f=fopen(outp,"wb"); if(!f){ fprintf(stderr,"Cannot open %s\n", outp); free(acc); free(tach); return 1; }
+
+  CaptureHeader h; memset(&h,0,sizeof(h));
+  h.magic=CAP_MAGIC; h.version=CAP_VERSION; h.header_bytes=CAP_HEADER_BYTES;
+  h.fs_hz=fs; h.channels=tach? 2 : 1; h.sample_type=(uint32_t)type;
+  h.scale=(type==CAP_INT16)? (float)scale : 1.0f; h.pod_id=pod; h.frames=(uint64_t)N;
+  capture_write_header(f,&h);
+
+  long clipped=0;
+  for(int i=0;i<N;i++){
+    double v[2]={ acc[i], tach? (isnan(tach[i])? 0.0 : tach[i]) : 0.0 };
+    for(unsigned c=0;c<h.channels;c++){
+      if(type==CAP_INT16){
+        long r=lrint(v[c]/(double)h.scale);
+        if(r>32767){ r=32767; clipped++; } else if(r<-32768){ r=-32768; clipped++; }
+        int16_t s=(int16_t)r; fwrite(&s,sizeof(s),1,f);
+      } else {
+        float s=(float)v[c]; fwrite(&s,sizeof(s),1,f);
+      }
+    }
+  }
+  int err=ferror(f); fclose(f);
+  fprintf(stderr,"Wrote %s (%d frames, %u ch, %s, fs=%.1f, pod=%u)%s\n", outp, N, h.channels,
+    type==CAP_INT16? "int16" : "float32", fs, pod, clipped? " [clipped]" : "");
+  free(acc); free(tach);
+  return err? 1 : 0;
+}
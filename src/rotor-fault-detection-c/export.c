@@ -0,0 +1,188 @@
+/*
+  export.c — packed int8 feature records (see export.h)
+  Feature layout (EXPORT_NF):
+    0-3    rms, peak, crest, kurtosis of the window
+    4-11   envelope power in octave bands fr/4 .. 64 fr (as in the trend log) [dB re median PSD]
+    12-15  envelope PSD at the predicted BPFO, BPFI, BSF, FTF, highest bin within +-2% [dB re median PSD]
+    16-19  SNR of the detected BPFO, BPFI, BSF, FTF peaks [dB] (0 when not found)
+    20     shaft rate [Hz]
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "export.h"
+#include "trend.h"
+
+_Static_assert(TREND_NF==12, "export layout assumes 4 time-domain features and 8 bands");
+
+#define EXPORT_TOL_REL 0.02          // the detector's search window around a predicted line
+
+struct ExportFile {
+  int fd; size_t head_bytes, rec_bytes;
+  ExportHeader h; ExportFeature ft[EXPORT_NF];
+  pthread_mutex_t lock;
+};
+
+const char *const export_feature[EXPORT_NF]={ "rms", "peak", "crest", "kurtosis",
+  "band_0.25x", "band_0.5x", "band_1x", "band_2x", "band_4x", "band_8x", "band_16x", "band_32x",
+  "env_bpfo", "env_bpfi", "env_bsf", "env_ftf", "snr_bpfo", "snr_bpfi", "snr_bsf", "snr_ftf", "fr" };
+
+/* Built-in ranges [lo, hi] mapped onto -128..127; a table calibrated on the model's
+   training data replaces them. */
+static const float export_range[EXPORT_NF][2]={ {0,4}, {0,16}, {0,16}, {0,32},
+  {-20,100}, {-20,100}, {-20,100}, {-20,100}, {-20,100}, {-20,100}, {-20,100}, {-20,100},
+  {-20,80}, {-20,80}, {-20,80}, {-20,80}, {0,64}, {0,64}, {0,64}, {0,64}, {0,128} };
+static const float patch_range[2]={ -20, 80 };
+
+static void quant_range(float lo, float hi, float *scale, int8_t *zp){
+  *scale=(hi-lo)/255.0f; *zp=(int8_t)lrintf(-128.0f - lo/(*scale));
+}
+
+static int8_t quant(float x, float scale, int8_t zp, int *clipped){
+  long q=lrintf(x/scale) + zp;
+  if(q<-128){ q=-128; *clipped=1; } else if(q>127){ q=127; *clipped=1; }
+  return (int8_t)q;
+}
+
+/* Highest envelope PSD bin within the search window around f [dB]; NaN without a spectrum. */
+static float line_level(const RfdResult *r, double f){
+  if(!r->psd || r->bins<2 || f<=0.0) return NAN;
+  double df=r->f_hz[1]-r->f_hz[0], tol=fmax(f*EXPORT_TOL_REL,df);
+  int k0=(int)floor((f-tol)/df), k1=(int)ceil((f+tol)/df);
+  if(k0<1) k0=1; if(k1>r->bins-1) k1=r->bins-1;
+  if(k0>k1) return NAN;
+  double p=0.0; for(int k=k0;k<=k1;k++) if(r->psd[k]>p) p=r->psd[k];
+  return p>0.0? (float)(10.0*log10(p)) : NAN;
+}
+
+static int cmp_double(const void *a, const void *b){ double x=*(const double*)a, y=*(const double*)b; return (x>y)-(x<y); }
+
+/* Median envelope PSD level (bins above DC) [dB]: the reference of every spectral feature. */
+static double psd_ref_db(const RfdResult *r){
+  int n=r->bins-1; if(!r->psd || n<1) return NAN;
+  double *v=(double*)malloc(sizeof(double)*n); if(!v) return NAN;
+  memcpy(v,r->psd+1,sizeof(double)*n); qsort(v,(size_t)n,sizeof(double),cmp_double);
+  double m=v[n/2]; free(v);
+  return m>0.0? 10.0*log10(m) : NAN;
+}
+
+static void features_from(float f[EXPORT_NF], const TrendRecord *t, const RfdResult *r, double ref){
+  const Detections *d=&r->det;
+  memcpy(f,t->f,sizeof(float)*TREND_NF);
+  for(int k=GATE_NF;k<TREND_NF;k++) f[k]-=(float)ref;
+  double pred[4]={ d->bpfo, d->bpfi, d->bsf, d->ftf };
+  for(int k=0;k<4;k++){
+    f[12+k]=line_level(r,pred[k])-(float)ref;
+    f[16+k]= r->psd? t->snr_db[k] : NAN;
+  }
+  f[20]=(float)d->fr;
+}
+
+void export_features(float f[EXPORT_NF], const RfdResult *r){
+  TrendRecord t; trend_record(&t,r,1);     // any non-zero time: only the features are used
+  features_from(f,&t,r,psd_ref_db(r));
+}
+
+/* Quantization table: built-in ranges, then any "name scale zero_point" lines of path. */
+static int load_quant(ExportFile *x, const char *path){
+  for(int k=0;k<EXPORT_NF;k++){
+    strncpy(x->ft[k].name,export_feature[k],sizeof(x->ft[k].name)-1);
+    quant_range(export_range[k][0],export_range[k][1],&x->ft[k].scale,&x->ft[k].zp);
+  }
+  quant_range(patch_range[0],patch_range[1],&x->h.patch_scale,&x->h.patch_zp);
+  if(!path[0]) return 0;
+  FILE *f=fopen(path,"r"); if(!f){ fprintf(stderr,"Cannot open --export-quant %s\n", path); return -1; }
+  char line[256]; int ln=0, rc=0;
+  while(fgets(line,sizeof(line),f)){
+    ln++; char *h=strchr(line,'#'); if(h) *h='\0';
+    char name[64]; float scale; int zp;
+    int n=sscanf(line,"%63s %f %d",name,&scale,&zp);
+    if(n<=0) continue;
+    if(n!=3 || !(scale>0.0f) || zp<-128 || zp>127){ fprintf(stderr,"%s:%d: expected \"name scale zero_point\"\n", path, ln); rc=-1; continue; }
+    int k=0; while(k<EXPORT_NF && strcmp(name,export_feature[k])!=0) k++;
+    if(k<EXPORT_NF){ x->ft[k].scale=scale; x->ft[k].zp=(int8_t)zp; }
+    else if(strcmp(name,"patch")==0){ x->h.patch_scale=scale; x->h.patch_zp=(int8_t)zp; }
+    else fprintf(stderr,"%s:%d: unknown feature %s\n", path, ln, name);
+  }
+  fclose(f);
+  return rc;
+}
+
+ExportFile *export_open(const char *path, const Config *cfg){
+  ExportFile *x=(ExportFile*)calloc(1,sizeof(ExportFile)); if(!x) return NULL;
+  x->fd=-1; pthread_mutex_init(&x->lock,NULL);
+  int T = cfg->patch_t>0 && cfg->patch_b>0? cfg->patch_t : 0, B = T? cfg->patch_b : 0;
+  x->head_bytes=sizeof(ExportHeader)+sizeof(ExportFeature)*EXPORT_NF;
+  x->rec_bytes=(sizeof(ExportRecordHead)+EXPORT_NF+(size_t)T*B+7) & ~(size_t)7;
+  ExportHeader *h=&x->h;
+  h->magic=EXPORT_MAGIC; h->version=EXPORT_VERSION; h->header_bytes=(uint16_t)x->head_bytes;
+  h->nf=EXPORT_NF; h->patch_t=(uint16_t)T; h->patch_b=(uint16_t)B; h->record_bytes=(uint32_t)x->rec_bytes;
+  if(T){ h->patch_lo_hz=(float)cfg->patch_lo; h->patch_hi_hz=(float)cfg->patch_hi; }
+  if(load_quant(x,cfg->export_quant)!=0){ export_close(x); return NULL; }
+  if(!T){ h->patch_scale=0.0f; h->patch_zp=0; }
+
+  x->fd=open(path,O_RDWR|O_CREAT|O_APPEND,0644);
+  if(x->fd<0){ fprintf(stderr,"Cannot open %s: %s\n", path, strerror(errno)); export_close(x); return NULL; }
+  char *want=(char*)malloc(x->head_bytes), *have=(char*)malloc(x->head_bytes);
+  memcpy(want,h,sizeof(*h)); memcpy(want+sizeof(*h),x->ft,sizeof(x->ft));
+  struct stat st; int ok = want && have && fstat(x->fd,&st)==0;
+  if(ok && st.st_size==0) ok = write(x->fd,want,x->head_bytes)==(ssize_t)x->head_bytes;
+  else if(ok){
+    ok = pread(x->fd,have,x->head_bytes,0)==(ssize_t)x->head_bytes && memcmp(want,have,x->head_bytes)==0;
+    if(!ok) fprintf(stderr,"%s was written with a different feature layout, patch shape or quantization table\n", path);
+  }
+  free(want); free(have);
+  if(!ok){ export_close(x); return NULL; }
+  return x;
+}
+
+void export_close(ExportFile *x){
+  if(!x) return;
+  if(x->fd>=0) close(x->fd);
+  pthread_mutex_destroy(&x->lock);
+  free(x);
+}
+
+size_t export_record_bytes(const ExportFile *x){ return x->rec_bytes; }
+
+void export_pack(const ExportFile *x, const RfdResult *r, int64_t t_us, void *rec){
+  memset(rec,0,x->rec_bytes);
+  TrendRecord t; trend_record(&t,r,t_us);
+  ExportRecordHead *h=(ExportRecordHead*)rec;
+  h->t_us=t.t_us; h->asset=t.asset; h->fault=t.fault; h->conf=t.conf;
+  h->flags=(uint16_t)((t.flags&TREND_GATED? EXPORT_GATED : 0) | (t.flags&TREND_FIXED? EXPORT_FIXED : 0) | (t.flags&TREND_ORDER? EXPORT_ORDER : 0));
+  double ref=psd_ref_db(r);
+  float f[EXPORT_NF]; features_from(f,&t,r,ref);
+  int8_t *q=(int8_t*)rec + sizeof(ExportRecordHead); int clipped=0;
+  for(int k=0;k<EXPORT_NF;k++){
+    if(isnan(f[k])){ h->missing|=1u<<k; q[k]=x->ft[k].zp; }
+    else q[k]=quant(f[k],x->ft[k].scale,x->ft[k].zp,&clipped);
+  }
+  int n=x->h.patch_t*x->h.patch_b; q+=EXPORT_NF;
+  if(n && r->patch && !isnan(ref) && r->patch_t==x->h.patch_t && r->patch_b==x->h.patch_b)
+    for(int i=0;i<n;i++) q[i]=quant(r->patch[i]-(float)ref,x->h.patch_scale,x->h.patch_zp,&clipped);
+  else if(n){ memset(q,x->h.patch_zp,(size_t)n); h->flags|=EXPORT_GATED; }
+  if(clipped) h->flags|=EXPORT_CLIPPED;
+}
+
+int export_write(ExportFile *x, const void *rec){
+  pthread_mutex_lock(&x->lock);
+  int rc = write(x->fd,rec,x->rec_bytes)==(ssize_t)x->rec_bytes? 0 : -1;   // O_APPEND: whole records
+  pthread_mutex_unlock(&x->lock);
+  return rc;
+}
+
+long export_records(const ExportFile *x){
+  struct stat st; if(fstat(x->fd,&st)!=0 || st.st_size<(off_t)x->head_bytes) return 0;
+  return (long)((st.st_size-(off_t)x->head_bytes)/(off_t)x->rec_bytes);
+}
@@ -0,0 +1,86 @@
+/*
+  export.h — packed int8 feature records for model runners (--export)
+  - One fixed-size record per window: detector decision plus EXPORT_NF features taken from
+    the window's own buffers (time-domain features, envelope PSD), and optionally the
+    --export-patch log-band STFT of the envelope, folded from the Welch segments
+  - Spectral values are dB relative to the window's median envelope PSD level, so they do
+    not depend on sensor gain or on the float / --fixed path's spectrum scaling
+  - Every value is quantized as q = clamp(round(x/scale) + zero_point, -128, 127); the
+    scale and zero point of each feature (and one pair for the patch) are stored in the
+    file header, so the runner dequantizes with (q - zero_point)*scale or feeds q as is
+  - File: ExportHeader, nf ExportFeature entries, then records of record_bytes each.
+    Runs append to an existing file only when its header matches byte for byte
+*/
+#ifndef ROTOR_FD_EXPORT_H
+#define ROTOR_FD_EXPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rotorfd.h"
+
+#define EXPORT_MAGIC   0x58444652u   // "RFDX"
+#define EXPORT_VERSION 2             // 2: record_bytes widened to 32 bits (256x256 patches)
+#define EXPORT_NF      21            // feature vector length (layout in export.c)
+#define EXPORT_PATCH_MAX 256         // frames or bands
+
+enum { EXPORT_GATED=1, EXPORT_FIXED=2, EXPORT_ORDER=4, EXPORT_CLIPPED=8 };
+
+typedef struct {
+  uint32_t magic;         // EXPORT_MAGIC
+  uint16_t version;       // EXPORT_VERSION
+  uint16_t header_bytes;  // this header + the feature table: offset of the first record
+  uint16_t nf;            // features per record
+  uint16_t patch_t, patch_b;   // patch frames x bands (0 x 0: no patch)
+  uint16_t pad0;
+  uint32_t record_bytes;
+  float    patch_lo_hz, patch_hi_hz;   // span of the patch's log-spaced bands
+  float    patch_scale;   // one scale / zero point for every patch value (dB)
+  int8_t   patch_zp;
+  uint8_t  pad[3];
+  uint8_t  reserved[28];
+} ExportHeader;
+
+typedef struct {
+  char     name[16];
+  float    scale;
+  int8_t   zp;
+  uint8_t  pad[3];
+} ExportFeature;
+
+/* Record: this head, nf feature bytes, patch_t*patch_b patch bytes (frame-major), zero
+   padding up to record_bytes. */
+typedef struct {
+  int64_t  t_us;          // window end (unix us)
+  uint32_t asset;         // pod id, or FNV-1a of the run name (as in the trend log)
+  uint16_t fault;         // 0 unknown, 1 outer race, 2 inner race, 3 ball, 4 cage
+  uint16_t flags;         // EXPORT_*
+  uint32_t missing;       // bit k: feature k not measured, stored as its zero point
+  float    conf;
+} ExportRecordHead;
+
+_Static_assert(sizeof(ExportHeader)==64, "ExportHeader must be 64 bytes");
+_Static_assert(sizeof(ExportFeature)==24, "ExportFeature must be 24 bytes");
+_Static_assert(sizeof(ExportRecordHead)==24, "ExportRecordHead must be 24 bytes");
+
+typedef struct ExportFile ExportFile;
+
+extern const char *const export_feature[EXPORT_NF];
+
+static inline float export_dequant(int8_t q, float scale, int8_t zp){ return (float)(q - zp)*scale; }
+
+/* Feature vector of a processed window in physical units; NaN where not measured. */
+void export_features(float f[EXPORT_NF], const RfdResult *r);
+
+/* Creates the file or appends to it; the quantization table comes from
+   Config::export_quant (lines "name scale zero_point", "patch" for the patch) or the
+   built-in ranges. NULL on error. */
+ExportFile *export_open(const char *path, const Config *cfg);
+void   export_close(ExportFile *x);
+size_t export_record_bytes(const ExportFile *x);
+/* Quantized record for r into rec (export_record_bytes() bytes); t_us 0 stamps now. */
+void   export_pack(const ExportFile *x, const RfdResult *r, int64_t t_us, void *rec);
+int    export_write(ExportFile *x, const void *rec);   // thread-safe
+long   export_records(const ExportFile *x);
+
+#endif
@@ -70,3 +70,17 @@
 ; FIR accumulator bound (sketch): with |x|<=32700, |h|<=32767, L taps
 ; Using 64-bit acc in C; we simply assert no 32-bit overflow after >>15 for L<=512.
 ; Full formalization omitted for brevity.
+
+; SIMD kernel check (q15_kernels.c): pmulhrsw computes (a*b + 2^14) >> 15 and keeps
+; the low 16 bits; the kernel then maps 0x8000 to 0x7FFF. Claim: equal to q15_mul
+; for all inputs, so the negation below must be unsat.
+(push)
+(declare-const ma (_ BitVec 16))
+(declare-const mb (_ BitVec 16))
+(define-fun mulhrs ((a (_ BitVec 16)) (b (_ BitVec 16))) (_ BitVec 16)
+  ((_ extract 15 0) (bvashr (bvadd (bvmul (sign_extend 16 a) (sign_extend 16 b)) #x00004000) #x0000000F)))
+(define-fun mulhrs_fix ((a (_ BitVec 16)) (b (_ BitVec 16))) (_ BitVec 16)
+  (let ((r (mulhrs a b))) (ite (= r #x8000) #x7FFF r)))
+(assert (not (= (mulhrs_fix ma mb) (q15_mul ma mb))))
+(check-sat) ; expect unsat
+(pop)
@@ -0,0 +1,46 @@
+/*
+  gen_q15_tables — emit pregenerated Q15 tables for the --fixed path
+  Usage: gen_q15_tables <N>               > q15_tab_<N>.h   (forward twiddles + Hann window)
+         gen_q15_tables --index <N>...    > q15_tables.h    (includes + size lookup)
+  Values come from q15_twiddle_fill()/q15_hann_fill(), the same routines the runtime
+  uses for sizes that are not pregenerated.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "q15_kernels.h"
+
+static int valid_size(int n){ return n>=4 && n<=(1<<20) && (n & (n-1))==0; }
+
+static void emit_size(int N){
+  q15c *tw=(q15c*)malloc(sizeof(q15c)*(N/2)); q15 *w=(q15*)malloc(sizeof(q15)*N);
+  q15_twiddle_fill(tw,N); q15_hann_fill(w,N);
+  printf("/* q15_tab_%d.h — generated by gen_q15_tables %d, do not edit */\n", N, N);
+  printf("static const q15c q15_tw_%d[%d]={\n", N, N/2);
+  for(int k=0;k<N/2;k++) printf("{%d,%d},%s", tw[k].re, tw[k].im, (k%8==7 || k==N/2-1)? "\n" : "");
+  printf("};\nstatic const q15 q15_hann_%d[%d]={\n", N, N);
+  for(int n=0;n<N;n++) printf("%d,%s", w[n], (n%16==15 || n==N-1)? "\n" : "");
+  printf("};\n");
+  free(tw); free(w);
+}
+
+static void emit_index(int argc, char **argv){
+  printf("/* q15_tables.h — generated by gen_q15_tables --index, do not edit */\n");
+  printf("#ifndef ROTOR_FD_Q15_TABLES_H\n#define ROTOR_FD_Q15_TABLES_H\n\n");
+  for(int i=0;i<argc;i++) printf("#include \"q15_tab_%d.h\"\n", atoi(argv[i]));
+  printf("\nstatic const struct { int n; const q15c *tw; const q15 *hann; } q15_tables[]={\n");
+  for(int i=0;i<argc;i++){ int n=atoi(argv[i]); printf("  { %d, q15_tw_%d, q15_hann_%d },\n", n, n, n); }
+  if(argc==0) printf("  { 0, NULL, NULL },\n");
+  printf("};\n#define Q15_TABLE_COUNT %d\n\n#endif\n", argc);
+}
+
+int main(int argc, char **argv){
+  if(argc>=2 && strcmp(argv[1],"--index")==0){
+    for(int i=2;i<argc;i++) if(!valid_size(atoi(argv[i]))){ fprintf(stderr,"gen_q15_tables: bad size %s\n", argv[i]); return 2; }
+    emit_index(argc-2,argv+2); return 0;
+  }
+  if(argc!=2 || !valid_size(atoi(argv[1]))){ fprintf(stderr,"usage: gen_q15_tables <N> | --index <N>...  (N: power of two, 4..2^20)\n"); return 2; }
+  emit_size(atoi(argv[1]));
+  return 0;
+}
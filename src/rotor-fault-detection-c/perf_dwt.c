@@ -0,0 +1,41 @@
+// perf_dwt.c - --profile hooks for the bare-metal STM32 build (see perf_port.h)
+// Cycle counts come from the DWT unit; wall-clock time is cycles / SystemCoreClock.
+// Peak heap is the _sbrk high-water mark kept by syscall.c.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "stm32n6xx_hal.h"
+#include "perf_port.h"
+
+extern size_t sbrk_heap_bytes(void);   // syscall.c
+
+void perf_init(void) {
+  // Trace enable lives in DCB on Armv8.1-M (Cortex-M55), CoreDebug on older cores.
+#if defined(DCB_DEMCR_TRCENA_Msk)
+  DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+#else
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#endif
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+// CYCCNT is 32 bits (about 5 s at 800 MHz); widen it, assuming we are called at least
+// once per wrap - every profiled stage boundary is.
+uint64_t perf_cycles(void) {
+  static uint32_t last;
+  static uint64_t high;
+  uint32_t now = DWT->CYCCNT;
+  if (now < last) high += (uint64_t)1 << 32;
+  last = now;
+  return high | now;
+}
+
+double perf_seconds(void) {
+  return (double)perf_cycles() / (double)SystemCoreClock;
+}
+
+size_t perf_heap_bytes(void) {
+  return sbrk_heap_bytes();
+}
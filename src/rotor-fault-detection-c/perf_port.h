@@ -0,0 +1,58 @@
+/*
+  perf_port.h — clock, cycle counter and heap hooks behind --profile
+  - Host: CLOCK_MONOTONIC, TSC on x86 / CNTVCT on AArch64, glibc heap statistics
+  - MCU (-DROTOR_FD_MCU): DWT->CYCCNT and the _sbrk high-water mark, implemented in
+    perf_dwt.c next to syscall.c
+*/
+#ifndef ROTOR_FD_PERF_PORT_H
+#define ROTOR_FD_PERF_PORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(ROTOR_FD_MCU)
+
+void     perf_init(void);          // enables the DWT cycle counter
+double   perf_seconds(void);       // CYCCNT / SystemCoreClock
+uint64_t perf_cycles(void);        // CYCCNT extended to 64 bits
+size_t   perf_heap_bytes(void);    // bytes handed out by _sbrk (never shrinks: peak heap)
+#define  PERF_CYCLE_SOURCE "dwt"
+
+#else
+
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PERF_CYCLE_SOURCE "tsc"
+#elif defined(__aarch64__)
+#define PERF_CYCLE_SOURCE "cntvct"
+#else
+#define PERF_CYCLE_SOURCE "none"
+#endif
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define PERF_HAVE_MALLINFO2 1
+#endif
+
+static inline void perf_init(void){}
+static inline double perf_seconds(void){ struct timespec ts; clock_gettime(CLOCK_MONOTONIC,&ts); return ts.tv_sec + ts.tv_nsec*1e-9; }
+static inline uint64_t perf_cycles(void){
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t v; __asm__ volatile("mrs %0, cntvct_el0" : "=r"(v)); return v;
+#else
+  return 0;
+#endif
+}
+/* Heap in use right now (arena + mmapped chunks); 0 where the C library cannot tell. */
+static inline size_t perf_heap_bytes(void){
+#ifdef PERF_HAVE_MALLINFO2
+  struct mallinfo2 mi=mallinfo2(); return mi.uordblks + mi.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+#endif
+#endif
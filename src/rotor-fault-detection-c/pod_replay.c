@@ -0,0 +1,109 @@
+/*
+  pod_replay — N simulated pods sending window packets to rotor_fd --serve
+  Usage: pod_replay --to udp:[host:]port|unix:path [--pods N] [--seconds S] [--input <capture.rfd>]
+                    [--fs <Hz>] [--packet P] [--speed X] [--pod-base ID]
+  Every pod streams the synthetic capture (or --input, looped from a per-pod offset) in
+  packets of P int16 samples, interleaved across pods. --speed 1 paces each pod at fs
+  (packet timestamps then match the wall clock, so the daemon's "age" is end-to-end
+  latency); --speed 0 sends as fast as the socket takes. Unix sockets block when the
+  daemon falls behind, UDP drops.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "serve.h"
+#include "capture.h"
+#include "q15_kernels.h"
+
+static void usage(void){
+  fprintf(stderr,"usage: pod_replay --to udp:[host:]port|unix:path [--pods N] [--seconds S] [--input <capture.rfd>]\n"
+                 "                  [--fs <Hz>] [--packet P] [--speed X] [--pod-base ID]\n");
+}
+
+static double real_s(void){ struct timespec ts; clock_gettime(CLOCK_REALTIME,&ts); return ts.tv_sec + ts.tv_nsec*1e-9; }
+
+/* Signal to replay as int16 counts at scale 1/32768 (Q15). */
+static int16_t *load_signal(const char *input, double *fs, int *len){
+  double *acc=NULL, *tach=NULL; int n=0;
+  if(input){
+    Capture cap; if(capture_open(input,&cap)!=0){ fprintf(stderr,"pod_replay: %s is not a binary capture (see csv2bin)\n", input); return NULL; }
+    *fs=cap.hdr.fs_hz; n=(int)cap.hdr.frames;
+    if(cap.hdr.sample_type==CAP_INT16 && cap.hdr.channels==1 && cap.hdr.scale==1.0f/32768.0f){
+      int16_t *x=(int16_t*)malloc(sizeof(int16_t)*n); if(x) memcpy(x,cap.samples,sizeof(int16_t)*n);
+      capture_close(&cap); *len=n; return x;
+    }
+    capture_to_double(&cap,&acc,&tach); capture_close(&cap); free(tach);
+  } else {
+    Config c; BearingGeom g; rfd_defaults(&c,&g);
+    n=(int)(*fs*2.0); acc=(double*)malloc(sizeof(double)*n);
+    rfd_synth(&g,*fs,n,acc,NULL);
+    for(int i=0;i<n;i++) acc[i]*=0.5;                // synthetic peaks reach ~1.6: keep them in range
+  }
+  int16_t *x=(int16_t*)malloc(sizeof(int16_t)*n);
+  for(int i=0;i<n;i++) x[i]=q15_from_double(acc[i]);
+  free(acc); *len=n;
+  return x;
+}
+
+int main(int argc, char **argv){
+  const char *to=NULL, *input=NULL; int pods=8, packet=1024; unsigned pod_base=1;
+  double seconds=10.0, fs=51200.0, speed=1.0;
+  for(int i=1;i<argc;i++){
+    if(strcmp(argv[i],"--to")==0 && i+1<argc) to=argv[++i];
+    else if(strcmp(argv[i],"--pods")==0 && i+1<argc) pods=atoi(argv[++i]);
+    else if(strcmp(argv[i],"--seconds")==0 && i+1<argc) seconds=atof(argv[++i]);
+    else if(strcmp(argv[i],"--input")==0 && i+1<argc) input=argv[++i];
+    else if(strcmp(argv[i],"--fs")==0 && i+1<argc) fs=atof(argv[++i]);
+    else if(strcmp(argv[i],"--packet")==0 && i+1<argc) packet=atoi(argv[++i]);
+    else if(strcmp(argv[i],"--speed")==0 && i+1<argc) speed=atof(argv[++i]);
+    else if(strcmp(argv[i],"--pod-base")==0 && i+1<argc) pod_base=(unsigned)strtoul(argv[++i],NULL,0);
+    else { usage(); return 2; }
+  }
+  if(!to || pods<1 || packet<1 || packet>PKT_MAX_SAMPLES || seconds<=0.0 || fs<=0.0 || speed<0.0){ usage(); return 2; }
+
+  struct sockaddr_storage sa; socklen_t salen;
+  int fam=serve_addr(to,"127.0.0.1",&sa,&salen);
+  if(fam<0){ fprintf(stderr,"pod_replay: bad --to %s\n", to); return 2; }
+  int fd=socket(fam,SOCK_DGRAM,0); if(fd<0){ perror("pod_replay: socket"); return 1; }
+
+  int len=0; int16_t *sig=load_signal(input,&fs,&len);
+  if(!sig || len<packet){ fprintf(stderr,"pod_replay: signal shorter than one packet\n"); free(sig); close(fd); return 1; }
+
+  long per_pod=(long)ceil(seconds*fs/packet), sent=0, errors=0;
+  char *pkt=(char*)malloc(PKT_HEADER_BYTES+sizeof(int16_t)*packet);
+  long *pos=(long*)malloc(sizeof(long)*pods);
+  for(int p=0;p<pods;p++) pos[p]=((long)p*len/pods) % len;   // pods out of phase with each other
+  PodPacket h; memset(&h,0,sizeof(h));
+  h.magic=PKT_MAGIC; h.version=PKT_VERSION; h.header_bytes=PKT_HEADER_BYTES;
+  h.fs_hz=(float)fs; h.scale=1.0f/32768.0f; h.n=(uint16_t)packet;
+
+  double t0=real_s();
+  for(long r=0;r<per_pod;r++){
+    if(speed>0.0){                                   // round r leaves once its last sample is acquired
+      double due=t0 + (r+1)*packet/(fs*speed), wait=due-real_s();
+      if(wait>0.0){ struct timespec ts={ (time_t)wait, (long)((wait-(double)(time_t)wait)*1e9) }; nanosleep(&ts,NULL); }
+    }
+    for(int p=0;p<pods;p++){
+      h.pod_id=pod_base+(unsigned)p; h.seq=(uint32_t)r;
+      h.t_us=(uint64_t)((t0 + r*packet/fs)*1e6);
+      memcpy(pkt,&h,sizeof(h));
+      int16_t *x=(int16_t*)(pkt+PKT_HEADER_BYTES);
+      for(int i=0;i<packet;i++){ x[i]=sig[pos[p]]; if(++pos[p]==len) pos[p]=0; }
+      ssize_t w=sendto(fd,pkt,PKT_HEADER_BYTES+sizeof(int16_t)*packet,0,(struct sockaddr*)&sa,salen);
+      if(w<0){ if(errors++==0) fprintf(stderr,"pod_replay: sendto: %s\n", strerror(errno)); } else sent++;
+    }
+  }
+  double dt=real_s()-t0;
+  fprintf(stderr,"pod_replay: %d pods, %ld packets (%ld failed) of %d samples in %.3f s — %.0f packets/s, %.2f Msamples/s\n",
+          pods, sent, errors, packet, dt, dt>0.0? sent/dt : 0.0, dt>0.0? sent*(double)packet/dt*1e-6 : 0.0);
+  free(pkt); free(pos); free(sig); close(fd);
+  return errors? 1 : 0;
+}
@@ -0,0 +1,224 @@
+/*
+  q15_kernels.c — scalar reference and x86 SIMD implementations of the Q15 hot loops
+  The SSE4.1/AVX2 bodies are compiled with per-function target attributes, so the
+  binary still runs on any x86-64 and only takes a path after the CPU reports it.
+*/
+#include "q15_kernels.h"
+#include "q15_tables.h"
+
+#include <stddef.h>
+#include <string.h>
+
+const q15c *q15_table_twiddles(int N){ for(int i=0;i<Q15_TABLE_COUNT;i++) if(q15_tables[i].n==N) return q15_tables[i].tw; return NULL; }
+const q15  *q15_table_hann(int N){ for(int i=0;i<Q15_TABLE_COUNT;i++) if(q15_tables[i].n==N) return q15_tables[i].hann; return NULL; }
+
+/* ---------------- Scalar reference ---------------- */
+static int64_t dot_scalar(const q15 *x, const q15 *h, int n){
+  int64_t acc=0; for(int i=0;i<n;i++) acc += (int32_t)x[i]*(int32_t)h[i]; return acc;
+}
+static void mul_scalar(const q15 *x, const q15 *w, q15 *out, int n){ for(int i=0;i<n;i++) out[i]=q15_mul(x[i],w[i]); }
+static void butterfly_scalar(q15c *a, q15c *b, const q15c *w, int n){ for(int k=0;k<n;k++) q15c_butterfly(&a[k],&b[k],w[k]); }
+static void butterfly_full_scalar(q15c *a, q15c *b, const q15c *w, int n){ for(int k=0;k<n;k++) q15c_butterfly_full(&a[k],&b[k],w[k]); }
+static void abs_scalar(const q15c *z, q15 *out, int n){ for(int i=0;i<n;i++) out[i]=q15c_abs_approx(z[i]); }
+
+static const Q15Kernels k_scalar={ "scalar", dot_scalar, mul_scalar, butterfly_scalar, butterfly_full_scalar, abs_scalar };
+const Q15Kernels *q15k=&k_scalar;
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define Q15K_X86 1
+#include <immintrin.h>
+
+/* pmaddwd only overflows for (-32768)*(-32768)+(-32768)*(-32768); callers keep -32768
+   out of h, so each pair sum fits in int32 and is widened to int64 before accumulating. */
+__attribute__((target("sse4.1")))
+static int64_t dot_sse41(const q15 *x, const q15 *h, int n){
+  __m128i acc=_mm_setzero_si128(); int i=0;
+  for(; i+8<=n; i+=8){
+    __m128i p=_mm_madd_epi16(_mm_loadu_si128((const __m128i*)(x+i)), _mm_loadu_si128((const __m128i*)(h+i)));
+    acc=_mm_add_epi64(acc,_mm_cvtepi32_epi64(p));
+    acc=_mm_add_epi64(acc,_mm_cvtepi32_epi64(_mm_srli_si128(p,8)));
+  }
+  int64_t r[2]; _mm_storeu_si128((__m128i*)r,acc);
+  return r[0]+r[1]+dot_scalar(x+i,h+i,n-i);
+}
+
+/* pmulhrsw is (a*b + 2^14) >> 15 except that -32768*-32768 wraps to -32768, the only
+   way it can produce -32768; flipping those lanes to 32767 gives q15_mul()'s saturation. */
+__attribute__((target("sse4.1")))
+static void mul_sse41(const q15 *x, const q15 *w, q15 *out, int n){
+  const __m128i m=_mm_set1_epi16(-32768); int i=0;
+  for(; i+8<=n; i+=8){
+    __m128i r=_mm_mulhrs_epi16(_mm_loadu_si128((const __m128i*)(x+i)), _mm_loadu_si128((const __m128i*)(w+i)));
+    _mm_storeu_si128((__m128i*)(out+i), _mm_xor_si128(r,_mm_cmpeq_epi16(r,m)));
+  }
+  mul_scalar(x+i,w+i,out+i,n-i);
+}
+
+/* Four complex products in 32-bit lanes: hsub/hadd give re=yr*wr-yi*wi and
+   im=yi*wr+yr*wi with the same wrap-around as the scalar int32 code, then the
+   rounding shift and a saturating pack. */
+__attribute__((target("sse4.1")))
+static inline __m128i cmul4_sse41(__m128i y, __m128i w){
+  __m128i y0=_mm_cvtepi16_epi32(y), y1=_mm_cvtepi16_epi32(_mm_srli_si128(y,8));
+  __m128i w0=_mm_cvtepi16_epi32(w), w1=_mm_cvtepi16_epi32(_mm_srli_si128(w,8));
+  __m128i re=_mm_hsub_epi32(_mm_mullo_epi32(y0,w0), _mm_mullo_epi32(y1,w1));
+  __m128i im=_mm_hadd_epi32(_mm_mullo_epi32(_mm_shuffle_epi32(y0,0xB1),w0), _mm_mullo_epi32(_mm_shuffle_epi32(y1,0xB1),w1));
+  const __m128i rnd=_mm_set1_epi32(1<<14);
+  re=_mm_srai_epi32(_mm_add_epi32(re,rnd),15); im=_mm_srai_epi32(_mm_add_epi32(im,rnd),15);
+  return _mm_unpacklo_epi16(_mm_packs_epi32(re,re), _mm_packs_epi32(im,im));
+}
+
+__attribute__((target("sse4.1")))
+static void butterfly_sse41(q15c *a, q15c *b, const q15c *w, int n){
+  int k=0;
+  for(; k+4<=n; k+=4){
+    __m128i u=_mm_loadu_si128((const __m128i*)(a+k));
+    __m128i v=cmul4_sse41(_mm_loadu_si128((const __m128i*)(b+k)), _mm_loadu_si128((const __m128i*)(w+k)));
+    _mm_storeu_si128((__m128i*)(a+k), _mm_srai_epi16(_mm_adds_epi16(u,v),1));
+    _mm_storeu_si128((__m128i*)(b+k), _mm_srai_epi16(_mm_subs_epi16(u,v),1));
+  }
+  butterfly_scalar(a+k,b+k,w+k,n-k);
+}
+
+__attribute__((target("sse4.1")))
+static void butterfly_full_sse41(q15c *a, q15c *b, const q15c *w, int n){
+  int k=0;
+  for(; k+4<=n; k+=4){
+    __m128i u=_mm_loadu_si128((const __m128i*)(a+k));
+    __m128i v=cmul4_sse41(_mm_loadu_si128((const __m128i*)(b+k)), _mm_loadu_si128((const __m128i*)(w+k)));
+    _mm_storeu_si128((__m128i*)(a+k), _mm_adds_epi16(u,v));
+    _mm_storeu_si128((__m128i*)(b+k), _mm_subs_epi16(u,v));
+  }
+  butterfly_full_scalar(a+k,b+k,w+k,n-k);
+}
+
+/* abs_epi16 maps -32768 to itself like the scalar int16 negate; the sum is formed in
+   32 bits, clipped high only and truncated to 16 bits (low wrap as in the scalar cast). */
+__attribute__((target("sse4.1")))
+static inline __m128i abs4_sse41(__m128i z){
+  __m128i a=_mm_abs_epi16(z);
+  __m128i re=_mm_srai_epi32(_mm_slli_epi32(a,16),16), im=_mm_srai_epi32(a,16);
+  __m128i v=_mm_add_epi32(_mm_max_epi32(re,im), _mm_srai_epi32(_mm_min_epi32(re,im),1));
+  return _mm_and_si128(_mm_min_epi32(v,_mm_set1_epi32(32767)), _mm_set1_epi32(0xFFFF));
+}
+
+__attribute__((target("sse4.1")))
+static void abs_sse41(const q15c *z, q15 *out, int n){
+  int i=0;
+  for(; i+8<=n; i+=8){
+    __m128i v0=abs4_sse41(_mm_loadu_si128((const __m128i*)(z+i))), v1=abs4_sse41(_mm_loadu_si128((const __m128i*)(z+i+4)));
+    _mm_storeu_si128((__m128i*)(out+i), _mm_packus_epi32(v0,v1));
+  }
+  abs_scalar(z+i,out+i,n-i);
+}
+
+static const Q15Kernels k_sse41={ "sse4.1", dot_sse41, mul_sse41, butterfly_sse41, butterfly_full_sse41, abs_sse41 };
+
+/* ---------------- AVX2: same recipes on 256-bit vectors ---------------- */
+__attribute__((target("avx2")))
+static int64_t dot_avx2(const q15 *x, const q15 *h, int n){
+  __m256i acc=_mm256_setzero_si256(); int i=0;
+  for(; i+16<=n; i+=16){
+    __m256i p=_mm256_madd_epi16(_mm256_loadu_si256((const __m256i*)(x+i)), _mm256_loadu_si256((const __m256i*)(h+i)));
+    acc=_mm256_add_epi64(acc,_mm256_cvtepi32_epi64(_mm256_castsi256_si128(p)));
+    acc=_mm256_add_epi64(acc,_mm256_cvtepi32_epi64(_mm256_extracti128_si256(p,1)));
+  }
+  int64_t r[4]; _mm256_storeu_si256((__m256i*)r,acc);
+  return r[0]+r[1]+r[2]+r[3]+dot_sse41(x+i,h+i,n-i);
+}
+
+__attribute__((target("avx2")))
+static void mul_avx2(const q15 *x, const q15 *w, q15 *out, int n){
+  const __m256i m=_mm256_set1_epi16(-32768); int i=0;
+  for(; i+16<=n; i+=16){
+    __m256i r=_mm256_mulhrs_epi16(_mm256_loadu_si256((const __m256i*)(x+i)), _mm256_loadu_si256((const __m256i*)(w+i)));
+    _mm256_storeu_si256((__m256i*)(out+i), _mm256_xor_si256(r,_mm256_cmpeq_epi16(r,m)));
+  }
+  mul_sse41(x+i,w+i,out+i,n-i);
+}
+
+/* Lane-wise hsub/hadd/unpack leave complex pairs as [c0 c1 c4 c5 | c2 c3 c6 c7];
+   the final 64-bit permute restores order. */
+__attribute__((target("avx2")))
+static inline __m256i cmul8_avx2(__m256i y, __m256i w){
+  __m256i y0=_mm256_cvtepi16_epi32(_mm256_castsi256_si128(y)), y1=_mm256_cvtepi16_epi32(_mm256_extracti128_si256(y,1));
+  __m256i w0=_mm256_cvtepi16_epi32(_mm256_castsi256_si128(w)), w1=_mm256_cvtepi16_epi32(_mm256_extracti128_si256(w,1));
+  __m256i re=_mm256_hsub_epi32(_mm256_mullo_epi32(y0,w0), _mm256_mullo_epi32(y1,w1));
+  __m256i im=_mm256_hadd_epi32(_mm256_mullo_epi32(_mm256_shuffle_epi32(y0,0xB1),w0), _mm256_mullo_epi32(_mm256_shuffle_epi32(y1,0xB1),w1));
+  const __m256i rnd=_mm256_set1_epi32(1<<14);
+  re=_mm256_srai_epi32(_mm256_add_epi32(re,rnd),15); im=_mm256_srai_epi32(_mm256_add_epi32(im,rnd),15);
+  __m256i v=_mm256_unpacklo_epi16(_mm256_packs_epi32(re,re), _mm256_packs_epi32(im,im));
+  return _mm256_permute4x64_epi64(v,0xD8);
+}
+
+__attribute__((target("avx2")))
+static void butterfly_avx2(q15c *a, q15c *b, const q15c *w, int n){
+  int k=0;
+  for(; k+8<=n; k+=8){
+    __m256i u=_mm256_loadu_si256((const __m256i*)(a+k));
+    __m256i v=cmul8_avx2(_mm256_loadu_si256((const __m256i*)(b+k)), _mm256_loadu_si256((const __m256i*)(w+k)));
+    _mm256_storeu_si256((__m256i*)(a+k), _mm256_srai_epi16(_mm256_adds_epi16(u,v),1));
+    _mm256_storeu_si256((__m256i*)(b+k), _mm256_srai_epi16(_mm256_subs_epi16(u,v),1));
+  }
+  butterfly_sse41(a+k,b+k,w+k,n-k);
+}
+
+__attribute__((target("avx2")))
+static void butterfly_full_avx2(q15c *a, q15c *b, const q15c *w, int n){
+  int k=0;
+  for(; k+8<=n; k+=8){
+    __m256i u=_mm256_loadu_si256((const __m256i*)(a+k));
+    __m256i v=cmul8_avx2(_mm256_loadu_si256((const __m256i*)(b+k)), _mm256_loadu_si256((const __m256i*)(w+k)));
+    _mm256_storeu_si256((__m256i*)(a+k), _mm256_adds_epi16(u,v));
+    _mm256_storeu_si256((__m256i*)(b+k), _mm256_subs_epi16(u,v));
+  }
+  butterfly_full_sse41(a+k,b+k,w+k,n-k);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i abs8_avx2(__m256i z){
+  __m256i a=_mm256_abs_epi16(z);
+  __m256i re=_mm256_srai_epi32(_mm256_slli_epi32(a,16),16), im=_mm256_srai_epi32(a,16);
+  __m256i v=_mm256_add_epi32(_mm256_max_epi32(re,im), _mm256_srai_epi32(_mm256_min_epi32(re,im),1));
+  return _mm256_and_si256(_mm256_min_epi32(v,_mm256_set1_epi32(32767)), _mm256_set1_epi32(0xFFFF));
+}
+
+__attribute__((target("avx2")))
+static void abs_avx2(const q15c *z, q15 *out, int n){
+  int i=0;
+  for(; i+16<=n; i+=16){
+    __m256i v=_mm256_packus_epi32(abs8_avx2(_mm256_loadu_si256((const __m256i*)(z+i))), abs8_avx2(_mm256_loadu_si256((const __m256i*)(z+i+8))));
+    _mm256_storeu_si256((__m256i*)(out+i), _mm256_permute4x64_epi64(v,0xD8));
+  }
+  abs_sse41(z+i,out+i,n-i);
+}
+
+static const Q15Kernels k_avx2={ "avx2", dot_avx2, mul_avx2, butterfly_avx2, butterfly_full_avx2, abs_avx2 };
+#else
+#define Q15K_X86 0
+#endif
+
+int q15k_select(int want){
+  int best=Q15K_SCALAR;
+#if Q15K_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("sse4.1")) best=Q15K_SSE41;
+  if(__builtin_cpu_supports("avx2")) best=Q15K_AVX2;
+#endif
+  if(want==Q15K_AUTO) want=best;
+  if(want>best){ q15k=&k_scalar; return -1; }
+#if Q15K_X86
+  q15k = want==Q15K_AVX2? &k_avx2 : want==Q15K_SSE41? &k_sse41 : &k_scalar;
+#else
+  q15k=&k_scalar;
+#endif
+  return 0;
+}
+
+int q15k_parse(const char *s){
+  if(strcmp(s,"auto")==0) return Q15K_AUTO;
+  if(strcmp(s,"scalar")==0) return Q15K_SCALAR;
+  if(strcmp(s,"sse4.1")==0 || strcmp(s,"sse41")==0) return Q15K_SSE41;
+  if(strcmp(s,"avx2")==0) return Q15K_AVX2;
+  return -1;
+}
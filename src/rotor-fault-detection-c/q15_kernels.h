@@ -0,0 +1,96 @@
+/*
+  q15_kernels.h — Q15 arithmetic and the vector kernel layer for the --fixed path
+  - Scalar helpers below are the reference semantics (see fixedpoint_checks.smt2)
+  - Hot loops go through a kernel table picked once at startup from the CPU features:
+    scalar, SSE4.1 or AVX2 on x86 (Helium MVE slots in the same way on the gateway)
+  - Every kernel is bit-exact against the scalar reference, including saturation
+  - Twiddle and Hann tables are pregenerated per size by gen_q15_tables (q15_tables.h),
+    so the fixed path does no floating-point work once its tables are in place
+*/
+#ifndef ROTOR_FD_Q15_KERNELS_H
+#define ROTOR_FD_Q15_KERNELS_H
+
+#include <stdint.h>
+#include <math.h>
+
+typedef int16_t q15;
+typedef struct { q15 re, im; } q15c;
+
+static inline q15 sat16(int32_t x){ if(x>32767) return 32767; if(x<-32768) return -32768; return (q15)x; }
+static inline q15 q15_from_double(double x){ if(x>=0.999969482421875) x=0.999969482421875; if(x<=-1.0) x=-1.0; int32_t v=(int32_t)lrint(x*32768.0); if(v==32768) v=32767; return (q15)v; }
+static inline double q15_to_double(q15 x){ return (double)x/32768.0; }
+static inline q15 q15_add(q15 a,q15 b){ return sat16((int32_t)a+(int32_t)b); }
+static inline q15 q15_sub(q15 a,q15 b){ return sat16((int32_t)a-(int32_t)b); }
+static inline q15 q15_mul(q15 a,q15 b){ int32_t p=(int32_t)a*(int32_t)b; int32_t r=(p + (1<<14)) >> 15; return sat16(r); }
+static inline q15c q15c_add(q15c a,q15c b){ q15c r={ q15_add(a.re,b.re), q15_add(a.im,b.im) }; return r; }
+static inline q15c q15c_sub(q15c a,q15c b){ q15c r={ q15_sub(a.re,b.re), q15_sub(a.im,b.im) }; return r; }
+static inline q15c q15c_mul(q15c a,q15c b){
+  int32_t pr = (int32_t)a.re*b.re - (int32_t)a.im*b.im;
+  int32_t pi = (int32_t)a.re*b.im + (int32_t)a.im*b.re;
+  q15c r={ sat16((pr + (1<<14))>>15), sat16((pi + (1<<14))>>15) }; return r;
+}
+
+/* Scaled radix-2 butterfly: v=b*w, a'=(a+v)>>1, b'=(a-v)>>1 with saturating add/sub. */
+static inline void q15c_butterfly(q15c *a, q15c *b, q15c w){
+  q15c u=*a, v=q15c_mul(*b,w);
+  q15c s=q15c_add(u,v), d=q15c_sub(u,v);
+  s.re = (q15)((int32_t)s.re >> 1); s.im = (q15)((int32_t)s.im >> 1);
+  d.re = (q15)((int32_t)d.re >> 1); d.im = (q15)((int32_t)d.im >> 1);
+  *a=s; *b=d;
+}
+
+/* Unscaled radix-2 butterfly: v=b*w, a'=a+v, b'=a-v, saturating. For transforms whose
+   output is known to fit (the inverse of a spectrum that was scaled on the way in). */
+static inline void q15c_butterfly_full(q15c *a, q15c *b, q15c w){
+  q15c u=*a, v=q15c_mul(*b,w);
+  *a=q15c_add(u,v); *b=q15c_sub(u,v);
+}
+
+/* |z| ~ max + min/2, clipped high only (matches the original MCU routine). */
+static inline q15 q15c_abs_approx(q15c z){
+  int16_t ar = z.re >= 0 ? z.re : -z.re;
+  int16_t ai = z.im >= 0 ? z.im : -z.im;
+  int16_t mx = ar > ai ? ar : ai;
+  int16_t mn = ar > ai ? ai : ar;
+  int32_t v = (int32_t)mx + ((int32_t)mn >> 1);
+  if(v>32767) v=32767; return (q15)v;
+}
+
+/* Table generators, shared by gen_q15_tables and the runtime fallback for sizes that
+   were not pregenerated, so both produce identical bits. */
+#define Q15_TWO_PI 6.283185307179586476925286766559
+static inline void q15_twiddle_fill(q15c *w, int N){   // forward W_N^k, k < N/2
+  for(int k=0;k<N/2;k++){ w[k].re=q15_from_double(cos(Q15_TWO_PI*k/N)); w[k].im=q15_from_double(-sin(Q15_TWO_PI*k/N)); }
+}
+static inline void q15_hann_fill(q15 *w, int N){
+  for(int n=0;n<N;n++){ double d=0.5*(1.0 - cos(Q15_TWO_PI*n/(N-1))); w[n]=q15_from_double(d); }
+}
+
+/* Pregenerated tables for size N, or NULL if N is not in the build's table set. */
+const q15c *q15_table_twiddles(int N);
+const q15  *q15_table_hann(int N);
+
+typedef struct {
+  const char *name;
+  /* sum_{i<n} x[i]*h[i] in 64 bits; h must not contain -32768 */
+  int64_t (*dot)(const q15 *x, const q15 *h, int n);
+  /* out[i] = q15_mul(x[i], w[i]) */
+  void (*mul)(const q15 *x, const q15 *w, q15 *out, int n);
+  /* q15c_butterfly(&a[k], &b[k], w[k]) for k<n */
+  void (*butterfly)(q15c *a, q15c *b, const q15c *w, int n);
+  /* q15c_butterfly_full(&a[k], &b[k], w[k]) for k<n */
+  void (*butterfly_full)(q15c *a, q15c *b, const q15c *w, int n);
+  /* out[i] = q15c_abs_approx(z[i]) */
+  void (*abs_approx)(const q15c *z, q15 *out, int n);
+} Q15Kernels;
+
+enum { Q15K_AUTO=0, Q15K_SCALAR, Q15K_SSE41, Q15K_AVX2 };
+
+extern const Q15Kernels *q15k;       // active table (scalar until q15k_select())
+
+/* Picks the widest kernel set the CPU supports, capped at `want` (Q15K_AUTO = no cap).
+   Returns 0, or -1 if `want` is not available here (the scalar set stays active). */
+int q15k_select(int want);
+int q15k_parse(const char *s);       // "auto|scalar|sse4.1|avx2" -> Q15K_*, -1 if unknown
+
+#endif
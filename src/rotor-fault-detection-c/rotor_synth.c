@@ -0,0 +1,355 @@
+/*
+  rotor_synth — synthetic fleet captures with ground truth, and a float vs --fixed accuracy run
+  Usage: rotor_synth [scenario options] --out-dir <dir> [--type int16|float32] [--no-tach]
+         rotor_synth [scenario options] --stdout [--labels <path>]
+         rotor_synth [scenario options] --eval [--order] [--out <path>]
+  Scenario options: [--count K] [--seconds S] [--fs Hz] [--faults healthy,outer,inner,ball,cage]
+                    [--rpm lo hi] [--ramp pct] [--snr lo hi] [--fc lo hi] [--slip pct]
+                    [--noise rms] [--same-bearing] [--seed S] [--threads T]
+  Scenario k draws its fault, bearing (7-12 elements, d/D 0.15-0.25, contact angle 0-15
+  deg), speed, ramp (up to +-pct over the capture), SNR, resonance, damping and slip from
+  the generator's counter RNG at (seed, k), so any scenario of a fleet can be regenerated
+  on its own. Varying the bearing keeps fixed harmonic coincidences of one geometry (the
+  default one has 3 BPFO = 2 BPFI) from deciding the accuracy; --same-bearing keeps the
+  default geometry, as a --stream run matches a single bearing.
+  --out-dir writes <dir>/synth_NNNNN.rfd (pod k+1, acc and tach unless --no-tach), a batch
+  manifest with each capture's geometry at its mean speed, and labels.csv. --stdout sends
+  the scenarios back to back as one binary capture stream for rotor_fd --stream. --eval
+  keeps everything in memory: each scenario is quantized to Q15 once, run through the
+  float and the fixed pipeline, and the report gives generation and pipeline throughput
+  and, per path, accuracy, false alarms and a decision table per true fault class.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "rotorfd.h"
+#include "capture.h"
+#include "q15_kernels.h"
+#include "synth.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define SYN_BLOCK 8192               // samples generated per write
+
+typedef struct {
+  long count; double seconds, fs;
+  int faults[SYN_CLASSES], nfaults;
+  double rpm_lo, rpm_hi, ramp, snr_lo, snr_hi, fc_lo, fc_hi, slip, noise;
+  uint64_t seed; int threads;
+  const char *dir, *labels, *out;
+  int type, tach, to_stdout, eval, order, same_bearing;
+} SynOpts;
+
+static void usage(void){
+  fprintf(stderr,"usage: rotor_synth [--count K] [--seconds S] [--fs Hz] [--faults healthy,outer,inner,ball,cage]\n"
+                 "                   [--rpm lo hi] [--ramp pct] [--snr lo hi] [--fc lo hi] [--slip pct] [--noise rms]\n"
+                 "                   [--same-bearing] [--seed S] [--threads T]\n"
+                 "                   (--out-dir <dir> [--type int16|float32] [--no-tach] | --stdout [--labels <path>]\n"
+                 "                    | --eval [--order] [--out <path>])\n");
+}
+
+static double now_s(void){ struct timespec ts; clock_gettime(CLOCK_MONOTONIC,&ts); return ts.tv_sec + ts.tv_nsec*1e-9; }
+/* Per-thread CPU time: stage timings stay per core when workers outnumber cores. */
+static double cpu_s(void){ struct timespec ts; clock_gettime(CLOCK_THREAD_CPUTIME_ID,&ts); return ts.tv_sec + ts.tv_nsec*1e-9; }
+
+static int parse_faults(SynOpts *o, const char *list){
+  char buf[128]; strncpy(buf,list,sizeof(buf)-1); buf[sizeof(buf)-1]='\0'; o->nfaults=0;
+  char *save=NULL;
+  for(char *tok=strtok_r(buf,",",&save); tok; tok=strtok_r(NULL,",",&save)){
+    SynthSpec s; synth_defaults(&s);
+    char kv[64]; snprintf(kv,sizeof(kv),"fault=%s",tok);
+    if(synth_parse(&s,kv)!=0 || o->nfaults==SYN_CLASSES) return -1;
+    o->faults[o->nfaults++]=s.fault;
+  }
+  return o->nfaults? 0 : -1;
+}
+
+/* Scenario k of the fleet. */
+static void draw_spec(const SynOpts *o, long k, SynthSpec *s){
+  synth_defaults(s);
+  uint64_t key=o->seed*0x9e3779b97f4a7c15ull; double u[12];
+  for(int j=0;j<12;j++) u[j]=synth_uniform(key,(uint64_t)k*16+(uint64_t)j);
+  s->fault=o->faults[(int)(u[0]*o->nfaults)];
+  s->fs=o->fs; s->seconds=o->seconds; s->noise_rms=o->noise;
+  s->rpm0=o->rpm_lo+u[1]*(o->rpm_hi-o->rpm_lo);
+  s->rpm1=s->rpm0*(1.0+(2.0*u[2]-1.0)*o->ramp/100.0);
+  s->snr_db=o->snr_lo+u[3]*(o->snr_hi-o->snr_lo);
+  s->fc=o->fc_lo+u[4]*(o->fc_hi-o->fc_lo);
+  s->zeta=0.02+0.03*u[5];
+  s->slip=u[6]*o->slip/100.0;
+  s->shaft=u[7];
+  if(!o->same_bearing){ s->g.n=7+(int)(u[8]*6); s->g.d=s->g.D*(0.15+0.10*u[9]); s->g.beta=u[10]*15.0*M_PI/180.0; }
+  s->seed=o->seed*1000003ull+(uint64_t)k;
+}
+
+static double mean_rpm(const SynthSpec *s){ return 0.5*(s->rpm0+s->rpm1); }
+
+static void write_label(FILE *f, const SynthSpec *s, long k, double t_start){
+  fprintf(f,"synth_%05ld,%ld,%s,%d,%.6f,%.6f,%.3f,%.3f,%.3f,%.4f,%.2f,%.1f,%.4f,%.3f,%llu,%.3f\n", k, k+1, synth_fault[s->fault],
+          s->g.n, s->g.d, s->g.D, s->g.beta*180.0/M_PI, s->rpm0, s->rpm1, synth_line_hz(s,mean_rpm(s)), s->snr_db,
+          s->fc, s->zeta, s->slip*100.0, (unsigned long long)s->seed, t_start);
+}
+static const char *label_header="name,pod,fault,n,d,D,beta_deg,rpm0,rpm1,line_hz,snr_db,fc_hz,zeta,slip_pct,seed,t_start_s\n";
+
+/* Saturating conversion to int16 at scale 1/32768 (Q15); returns clipped samples. */
+static long to_q15(const double *x, int16_t *q, int n){
+  long c=0;
+  for(int i=0;i<n;i++){ if(x[i]>=1.0 || x[i]<-1.0) c++; q[i]=q15_from_double(x[i]); }
+  return c;
+}
+
+/* One scenario as interleaved capture frames on f (header written by the caller). */
+static long write_frames(FILE *f, const SynOpts *o, const SynthSpec *s, long N, double *acc, double *tach, void *frames){
+  SynthGen g; synth_init(&g,s); long clipped=0; int ch=o->tach? 2 : 1;
+  for(long i0=0;i0<N;i0+=SYN_BLOCK){
+    int m = N-i0<SYN_BLOCK? (int)(N-i0) : SYN_BLOCK;
+    synth_block(&g,acc,o->tach? tach : NULL,m);
+    if(o->type==CAP_INT16){
+      int16_t *q=(int16_t*)frames;
+      for(int i=0;i<m;i++){
+        if(acc[i]>=1.0 || acc[i]<-1.0) clipped++;
+        q[i*ch]=q15_from_double(acc[i]); if(ch==2) q[i*ch+1]=(int16_t)(tach[i]>0.5? 32767 : 0);
+      }
+    } else {
+      float *v=(float*)frames;
+      for(int i=0;i<m;i++){ v[i*ch]=(float)acc[i]; if(ch==2) v[i*ch+1]=(float)tach[i]; }
+    }
+    fwrite(frames,(o->type==CAP_INT16? 2 : 4)*(size_t)ch,(size_t)m,f);
+  }
+  return clipped;
+}
+
+static void capture_header(CaptureHeader *h, const SynOpts *o, long N, unsigned pod){
+  memset(h,0,sizeof(*h));
+  h->magic=CAP_MAGIC; h->version=CAP_VERSION; h->header_bytes=CAP_HEADER_BYTES;
+  h->fs_hz=o->fs; h->channels=o->tach? 2 : 1; h->sample_type=(uint32_t)o->type;
+  h->scale=o->type==CAP_INT16? 1.0f/32768.0f : 1.0f; h->pod_id=pod; h->frames=(uint64_t)N;
+}
+
+/* ---------------- --out-dir: one capture per scenario, on T threads ---------------- */
+typedef struct { const SynOpts *o; int id; long clipped, failed; } FileWorker;
+
+static void *file_worker(void *arg){
+  FileWorker *w=(FileWorker*)arg; const SynOpts *o=w->o;
+  long N=(long)(o->seconds*o->fs);
+  double *acc=(double*)malloc(sizeof(double)*SYN_BLOCK), *tach=(double*)malloc(sizeof(double)*SYN_BLOCK);
+  void *frames=malloc(sizeof(float)*2*SYN_BLOCK);
+  for(long k=w->id;k<o->count;k+=o->threads){
+    SynthSpec s; draw_spec(o,k,&s);
+    char path[1024]; snprintf(path,sizeof(path),"%s/synth_%05ld.rfd", o->dir, k);
+    FILE *f=fopen(path,"wb"); if(!f){ if(w->failed++==0) fprintf(stderr,"rotor_synth: cannot write %s\n", path); continue; }
+    CaptureHeader h; capture_header(&h,o,N,(unsigned)(k+1)); capture_write_header(f,&h);
+    w->clipped+=write_frames(f,o,&s,N,acc,tach,frames);
+    if(ferror(f)) w->failed++;
+    fclose(f);
+  }
+  free(acc); free(tach); free(frames);
+  return NULL;
+}
+
+static int run_files(const SynOpts *o){
+  char path[1024];
+  snprintf(path,sizeof(path),"%s/labels.csv", o->dir); FILE *lf=fopen(path,"w");
+  snprintf(path,sizeof(path),"%s/manifest.txt", o->dir); FILE *mf=fopen(path,"w");
+  if(!lf || !mf){ fprintf(stderr,"rotor_synth: cannot write into %s\n", o->dir); if(lf) fclose(lf); if(mf) fclose(mf); return 1; }
+  fputs(label_header,lf);
+  fprintf(mf,"# rotor_synth: %ld scenarios, seed %llu (labels.csv holds the ground truth)\n", o->count, (unsigned long long)o->seed);
+  for(long k=0;k<o->count;k++){
+    SynthSpec s; draw_spec(o,k,&s); write_label(lf,&s,k,0.0);
+    fprintf(mf,"%s/synth_%05ld.rfd --name synth_%05ld --geom n=%d,d=%.6f,D=%.6f,beta_deg=%.3f,rpm=%.3f\n", o->dir, k, k,
+            s.g.n, s.g.d, s.g.D, s.g.beta*180.0/M_PI, mean_rpm(&s));
+  }
+  fclose(lf); fclose(mf);
+
+  FileWorker *w=(FileWorker*)calloc(o->threads,sizeof(FileWorker)); pthread_t *th=(pthread_t*)malloc(sizeof(pthread_t)*o->threads);
+  double t0=now_s();
+  for(int t=0;t<o->threads;t++){ w[t].o=o; w[t].id=t; pthread_create(&th[t],NULL,file_worker,&w[t]); }
+  long clipped=0, failed=0;
+  for(int t=0;t<o->threads;t++){ pthread_join(th[t],NULL); clipped+=w[t].clipped; failed+=w[t].failed; }
+  double dt=now_s()-t0, samples=(double)o->count*(long)(o->seconds*o->fs);
+  fprintf(stderr,"rotor_synth: %ld captures in %s, %.1f Msamples in %.3f s — %.1f Msamples/s, %.0fx real time (%d threads)%s\n",
+          o->count, o->dir, samples*1e-6, dt, dt>0.0? samples/dt*1e-6 : 0.0, dt>0.0? samples/o->fs/dt : 0.0, o->threads,
+          clipped? " [clipped]" : "");
+  free(w); free(th);
+  return failed? 1 : 0;
+}
+
+/* ---------------- --stdout: one capture stream, scenario after scenario ---------------- */
+static int run_stdout(const SynOpts *o){
+  FILE *lf=NULL;
+  if(o->labels){ lf=fopen(o->labels,"w"); if(!lf){ fprintf(stderr,"rotor_synth: cannot write %s\n", o->labels); return 1; } fputs(label_header,lf); }
+  long N=(long)(o->seconds*o->fs), clipped=0;
+  CaptureHeader h; capture_header(&h,o,0,1);       // frames 0: a stream of unknown length
+  capture_write_header(stdout,&h);
+  double *acc=(double*)malloc(sizeof(double)*SYN_BLOCK), *tach=(double*)malloc(sizeof(double)*SYN_BLOCK);
+  void *frames=malloc(sizeof(float)*2*SYN_BLOCK);
+  double t0=now_s(); long k=0;
+  for(;k<o->count && !ferror(stdout);k++){
+    SynthSpec s; draw_spec(o,k,&s);
+    if(lf){ write_label(lf,&s,k,k*o->seconds); fflush(lf); }
+    clipped+=write_frames(stdout,o,&s,N,acc,tach,frames);
+  }
+  fflush(stdout);
+  double dt=now_s()-t0, samples=(double)k*N;
+  fprintf(stderr,"rotor_synth: %ld scenarios to stdout, %.1f Msamples in %.3f s — %.0fx real time%s\n",
+          k, samples*1e-6, dt, dt>0.0? samples/o->fs/dt : 0.0, clipped? " [clipped]" : "");
+  if(lf) fclose(lf);
+  free(acc); free(tach); free(frames);
+  return k<o->count? 1 : 0;
+}
+
+/* ---------------- --eval: float vs --fixed on the same Q15 signal ---------------- */
+enum { EV_FLOAT, EV_FIXED, EV_PATHS };
+static const char *const ev_path[EV_PATHS]={ "float", "fixed" };
+
+typedef struct { int truth, dec[EV_PATHS], line[EV_PATHS]; } EvalRow;
+
+typedef struct {
+  const SynOpts *o; int id; PlanCache *pc; EvalRow *rows;
+  double gen_s, run_s[EV_PATHS]; long clipped, failed;
+} EvalWorker;
+
+static int decision_class(const char *fault){
+  for(int c=1;c<SYN_CLASSES;c++) if(strcmp(fault,synth_fault[c])==0) return c;
+  return SYN_HEALTHY;               // "unknown"
+}
+
+/* Did the spectrum hold the true fault's line (any line for a healthy machine)? */
+static int line_found(const Detections *d, int truth){
+  switch(truth){
+    case SYN_OUTER: return d->hz_bpfo.found;
+    case SYN_INNER: return d->hz_bpfi.found;
+    case SYN_BALL:  return d->hz_bsf.found;
+    case SYN_CAGE:  return d->hz_ftf.found;
+    default:        return d->hz_bpfo.found || d->hz_bpfi.found || d->hz_bsf.found || d->hz_ftf.found;
+  }
+}
+
+static void *eval_worker(void *arg){
+  EvalWorker *w=(EvalWorker*)arg; const SynOpts *o=w->o;
+  int N=(int)(o->seconds*o->fs);
+  Config cfg; BearingGeom g; rfd_defaults(&cfg,&g);
+  cfg.fs=o->fs; cfg.duration_s=o->seconds; cfg.threads=1; cfg.enable_order=o->order;
+  RfdContext *ctx[EV_PATHS];
+  for(int p=0;p<EV_PATHS;p++){ cfg.fixed=p==EV_FIXED; ctx[p]=rfd_create(&cfg,&g,w->pc); }
+  double *acc=(double*)malloc(sizeof(double)*N), *tach=(double*)malloc(sizeof(double)*N);
+  int16_t *q=(int16_t*)malloc(sizeof(int16_t)*N);
+  if(!ctx[EV_FLOAT] || !ctx[EV_FIXED] || !acc || !tach || !q){ w->failed=o->count; goto done; }
+  for(long k=w->id;k<o->count;k+=o->threads){
+    SynthSpec s; draw_spec(o,k,&s); EvalRow *row=&w->rows[k]; row->truth=s.fault;
+    double t0=cpu_s();
+    SynthGen sg; synth_init(&sg,&s); synth_block(&sg,acc,tach,N);
+    w->gen_s+=cpu_s()-t0;
+    w->clipped+=to_q15(acc,q,N);
+    for(int i=0;i<N;i++) acc[i]=q[i]*(1.0/32768.0);   // both paths see the same samples
+    g=s.g; g.rpm=mean_rpm(&s);
+    for(int p=0;p<EV_PATHS;p++){
+      cfg.fixed=p==EV_FIXED; rfd_configure(ctx[p],&cfg,&g);
+      RfdWindow win={ p==EV_FIXED? NULL : acc, p==EV_FIXED? q : NULL, o->order? tach : NULL, N, o->fs, k+1 };
+      RfdResult r; t0=cpu_s();
+      if(rfd_process_window(ctx[p],&win,&r)!=0){ w->failed++; row->dec[p]=-1; continue; }
+      w->run_s[p]+=cpu_s()-t0;
+      row->dec[p]=decision_class(r.det.fault); row->line[p]=line_found(&r.det,s.fault);
+    }
+  }
+done:
+  for(int p=0;p<EV_PATHS;p++) rfd_destroy(ctx[p]);
+  free(acc); free(tach); free(q);
+  return NULL;
+}
+
+static int run_eval(const SynOpts *o){
+  FILE *out = strcmp(o->out,"-")==0? stdout : fopen(o->out,"w");
+  if(!out){ fprintf(stderr,"rotor_synth: cannot write %s\n", o->out); return 1; }
+  EvalRow *rows=(EvalRow*)calloc(o->count,sizeof(EvalRow));
+  EvalWorker *w=(EvalWorker*)calloc(o->threads,sizeof(EvalWorker)); pthread_t *th=(pthread_t*)malloc(sizeof(pthread_t)*o->threads);
+  PlanCache *pc=rfd_cache_create();
+  double t0=now_s();
+  for(int t=0;t<o->threads;t++){ w[t].o=o; w[t].id=t; w[t].pc=pc; w[t].rows=rows; pthread_create(&th[t],NULL,eval_worker,&w[t]); }
+  double gen_s=0.0, run_s[EV_PATHS]={0}; long clipped=0, failed=0;
+  for(int t=0;t<o->threads;t++){
+    pthread_join(th[t],NULL);
+    gen_s+=w[t].gen_s; clipped+=w[t].clipped; failed+=w[t].failed;
+    for(int p=0;p<EV_PATHS;p++) run_s[p]+=w[t].run_s[p];
+  }
+  double wall=now_s()-t0, signal_s=o->count*o->seconds, samples=o->count*(double)(long)(o->seconds*o->fs);
+
+  fprintf(out,"{\n  \"synth\": {\"scenarios\": %ld, \"seconds\": %.3f, \"fs_hz\": %.1f, \"seed\": %llu, \"threads\": %d, \"order\": %s,\n",
+          o->count, o->seconds, o->fs, (unsigned long long)o->seed, o->threads, o->order? "true" : "false");
+  fprintf(out,"            \"rpm\": [%.1f, %.1f], \"ramp_pct\": %.1f, \"snr_db\": [%.1f, %.1f], \"slip_pct\": %.2f, \"wall_s\": %.3f},\n",
+          o->rpm_lo, o->rpm_hi, o->ramp, o->snr_lo, o->snr_hi, o->slip, wall);
+  fprintf(out,"  \"generate\": {\"cpu_s\": %.4f, \"samples_per_s\": %.4e, \"realtime_x\": %.1f, \"clipped_samples\": %ld},\n  \"paths\": [\n",
+          gen_s, gen_s>0.0? samples/gen_s : 0.0, gen_s>0.0? signal_s/gen_s : 0.0, clipped);
+  for(int p=0;p<EV_PATHS;p++){
+    long n[SYN_CLASSES]={0}, ok[SYN_CLASSES]={0}, line[SYN_CLASSES]={0}, dec[SYN_CLASSES][SYN_CLASSES]={{0}}, correct=0, total=0, healthy=0, alarms=0;
+    for(long k=0;k<o->count;k++){
+      const EvalRow *r=&rows[k]; if(r->dec[p]<0) continue;
+      n[r->truth]++; total++; line[r->truth]+=r->line[p]; dec[r->truth][r->dec[p]]++;
+      if(r->dec[p]==r->truth){ ok[r->truth]++; correct++; }
+      if(r->truth==SYN_HEALTHY){ healthy++; alarms+=r->dec[p]!=SYN_HEALTHY; }
+    }
+    fprintf(out,"    {\"path\": \"%s\", \"cpu_s\": %.4f, \"realtime_x\": %.1f, \"windows\": %ld, \"accuracy\": %.4f, \"false_alarm_rate\": %.4f,\n     \"classes\": [",
+            ev_path[p], run_s[p], run_s[p]>0.0? signal_s/run_s[p] : 0.0, total, total? (double)correct/total : 0.0, healthy? (double)alarms/healthy : 0.0);
+    for(int c=0;c<SYN_CLASSES;c++){
+      fprintf(out,"%s\n       {\"fault\": \"%s\", \"n\": %ld, \"recall\": %.4f, \"line_found\": %.4f, \"decisions\": {", c? "," : "",
+              synth_fault[c], n[c], n[c]? (double)ok[c]/n[c] : 0.0, n[c]? (double)line[c]/n[c] : 0.0);
+      for(int d=0;d<SYN_CLASSES;d++) fprintf(out,"%s\"%s\": %ld", d? ", " : "", synth_expected(d), dec[c][d]);
+      fprintf(out,"}}");
+    }
+    fprintf(out,"\n     ]}%s\n", p+1<EV_PATHS? "," : "");
+  }
+  fprintf(out,"  ]\n}\n");
+  if(out!=stdout) fclose(out);
+  fprintf(stderr,"rotor_synth: %ld scenarios in %.2f s; generation %.0fx real time per core, float %.0fx, fixed %.0fx%s\n",
+          o->count, wall, gen_s>0.0? signal_s/gen_s : 0.0, run_s[0]>0.0? signal_s/run_s[0] : 0.0, run_s[1]>0.0? signal_s/run_s[1] : 0.0,
+          failed? " [failures]" : "");
+  rfd_cache_destroy(pc); free(rows); free(w); free(th);
+  return failed? 1 : 0;
+}
+
+int main(int argc, char **argv){
+  SynOpts o; memset(&o,0,sizeof(o));
+  o.count=100; o.seconds=2.0; o.fs=51200.0; o.rpm_lo=1200.0; o.rpm_hi=2400.0; o.snr_lo=-18.0; o.snr_hi=0.0;
+  o.fc_lo=4500.0; o.fc_hi=7500.0; o.slip=2.0; o.noise=0.05; o.seed=1; o.threads=1;
+  o.type=CAP_INT16; o.tach=1; o.out="-";
+  parse_faults(&o,"healthy,outer,inner,ball,cage");
+  for(int i=1;i<argc;i++){
+    if(strcmp(argv[i],"--count")==0 && i+1<argc) o.count=atol(argv[++i]);
+    else if(strcmp(argv[i],"--seconds")==0 && i+1<argc) o.seconds=atof(argv[++i]);
+    else if(strcmp(argv[i],"--fs")==0 && i+1<argc) o.fs=atof(argv[++i]);
+    else if(strcmp(argv[i],"--faults")==0 && i+1<argc){ if(parse_faults(&o,argv[++i])!=0){ usage(); return 2; } }
+    else if(strcmp(argv[i],"--rpm")==0 && i+2<argc){ o.rpm_lo=atof(argv[++i]); o.rpm_hi=atof(argv[++i]); }
+    else if(strcmp(argv[i],"--ramp")==0 && i+1<argc) o.ramp=atof(argv[++i]);
+    else if(strcmp(argv[i],"--snr")==0 && i+2<argc){ o.snr_lo=atof(argv[++i]); o.snr_hi=atof(argv[++i]); }
+    else if(strcmp(argv[i],"--fc")==0 && i+2<argc){ o.fc_lo=atof(argv[++i]); o.fc_hi=atof(argv[++i]); }
+    else if(strcmp(argv[i],"--slip")==0 && i+1<argc) o.slip=atof(argv[++i]);
+    else if(strcmp(argv[i],"--noise")==0 && i+1<argc) o.noise=atof(argv[++i]);
+    else if(strcmp(argv[i],"--same-bearing")==0) o.same_bearing=1;
+    else if(strcmp(argv[i],"--seed")==0 && i+1<argc) o.seed=strtoull(argv[++i],NULL,0);
+    else if(strcmp(argv[i],"--threads")==0 && i+1<argc) o.threads=atoi(argv[++i]);
+    else if(strcmp(argv[i],"--out-dir")==0 && i+1<argc) o.dir=argv[++i];
+    else if(strcmp(argv[i],"--type")==0 && i+1<argc){ o.type=strcmp(argv[++i],"float32")==0? CAP_FLOAT32 : CAP_INT16; }
+    else if(strcmp(argv[i],"--no-tach")==0) o.tach=0;
+    else if(strcmp(argv[i],"--stdout")==0) o.to_stdout=1;
+    else if(strcmp(argv[i],"--labels")==0 && i+1<argc) o.labels=argv[++i];
+    else if(strcmp(argv[i],"--eval")==0) o.eval=1;
+    else if(strcmp(argv[i],"--order")==0) o.order=1;
+    else if(strcmp(argv[i],"--out")==0 && i+1<argc) o.out=argv[++i];
+    else { usage(); return 2; }
+  }
+  if((!!o.dir + o.to_stdout + o.eval)!=1 || o.count<1 || o.seconds<=0.0 || o.fs<=0.0 || o.threads<1
+     || o.rpm_lo<=0.0 || o.rpm_hi<o.rpm_lo || o.ramp<0.0 || o.ramp>=100.0 || o.fc_lo<=0.0 || o.fc_hi<o.fc_lo || o.fc_hi>=0.5*o.fs
+     || o.slip<0.0 || o.noise<0.0){ usage(); return 2; }
+  if(o.eval) return run_eval(&o);
+  if(o.to_stdout) return run_stdout(&o);
+  return run_files(&o);
+}
@@ -0,0 +1,1845 @@
+
+/*
+  rotorfd.c — librotorfd pipeline (API in rotorfd.h, JSON writer in rotorfd_json.c)
+  - Float path: band-pass (FIR, float) -> Hilbert envelope (FFT, float) -> Welch PSD -> detections (+ optional order tracking)
+  - Fixed path (--fixed): Q15 FIR + Q15 FFT analytic signal + Q15 Welch PSD -> detections (Hz domain)
+  - No external libs (C11 + libm + POSIX threads).
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "rotorfd.h"
+#include "capture.h"
+#include "q15_kernels.h"
+#include "perf_port.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static int next_pow2(int n){ int p=1; while(p<n) p<<=1; return p; }
+// FFT lengths: even, no prime factor above 5 (see the mixed-radix FFT below)
+static int fft_len_ok(int n){
+  if(n<2 || (n&1)) return 0;
+  while(n%2==0) n/=2; while(n%3==0) n/=3; while(n%5==0) n/=5;
+  return n==1;
+}
+static int fft_len_up(int n){ if(n<2) n=2; while(!fft_len_ok(n)) n++; return n; }
+int rfd_fft_len(int n){ return fft_len_up(n); }
+static double clamp(double x, double lo, double hi){ return x<lo?lo:(x>hi?hi:x); }
+
+/* ---------------- Intra-capture threading ----------------
+   par_for() splits [0,n) into `threads` contiguous chunks and runs chunk 0 on the caller.
+   The other chunks go to the workers of the ParPool bound to the calling thread (each
+   context owns one and binds it for a window; workers park on a condition variable
+   between calls, so an FFT stage costs a wake-up instead of a thread create and join).
+   Without a large enough idle pool they run on short-lived pthreads. Chunk bounds depend
+   only on (n, threads), so per-chunk partial results reduced in chunk order are
+   reproducible run to run. */
+#define PAR_MAX_THREADS 64
+
+typedef void (*ParFn)(void *ctx, int lo, int hi, int tid);
+typedef struct { ParFn fn; void *ctx; int lo, hi, tid; } ParTask;
+
+typedef struct ParPool ParPool;
+typedef struct { ParPool *pool; int tid; } ParWorker;
+struct ParPool {
+  int n, busy;                        // threads including the caller; a par_for is running
+  pthread_t tid[PAR_MAX_THREADS]; ParWorker wk[PAR_MAX_THREADS];
+  pthread_mutex_t mu; pthread_cond_t go, done;
+  unsigned gen; int pending, quit;    // dispatch generation, workers still running it
+  ParFn fn; void *ctx; int len, chunks;
+};
+static _Thread_local ParPool *par_pool;
+
+static void *par_task_run(void *arg){ ParTask *t=(ParTask*)arg; t->fn(t->ctx,t->lo,t->hi,t->tid); return NULL; }
+
+static int par_lo(int n, int t, int threads){ return (int)((long long)n*t/threads); }
+
+static void *par_worker(void *arg){
+  ParWorker *w=(ParWorker*)arg; ParPool *p=w->pool; unsigned seen=0;
+  pthread_mutex_lock(&p->mu);
+  for(;;){
+    while(p->gen==seen && !p->quit) pthread_cond_wait(&p->go,&p->mu);
+    if(p->quit) break;
+    seen=p->gen; ParFn fn=p->fn; void *ctx=p->ctx; int n=p->len, T=p->chunks, t=w->tid;
+    pthread_mutex_unlock(&p->mu);
+    if(t<T) fn(ctx,par_lo(n,t,T),par_lo(n,t+1,T),t);
+    pthread_mutex_lock(&p->mu);
+    if(--p->pending==0) pthread_cond_signal(&p->done);
+  }
+  pthread_mutex_unlock(&p->mu);
+  return NULL;
+}
+
+static void par_pool_destroy(ParPool *p){
+  if(!p) return;
+  pthread_mutex_lock(&p->mu); p->quit=1; pthread_cond_broadcast(&p->go); pthread_mutex_unlock(&p->mu);
+  for(int t=1;t<p->n;t++) pthread_join(p->tid[t],NULL);
+  pthread_cond_destroy(&p->go); pthread_cond_destroy(&p->done); pthread_mutex_destroy(&p->mu);
+  free(p);
+}
+
+/* NULL for one thread (nothing to pool) or when the workers cannot be started. */
+static ParPool *par_pool_create(int threads){
+  if(threads>PAR_MAX_THREADS) threads=PAR_MAX_THREADS;
+  if(threads<2) return NULL;
+  ParPool *p=(ParPool*)calloc(1,sizeof(ParPool)); if(!p) return NULL;
+  pthread_mutex_init(&p->mu,NULL); pthread_cond_init(&p->go,NULL); pthread_cond_init(&p->done,NULL);
+  for(p->n=1;p->n<threads;p->n++){
+    p->wk[p->n].pool=p; p->wk[p->n].tid=p->n;
+    if(pthread_create(&p->tid[p->n],NULL,par_worker,&p->wk[p->n])!=0) break;
+  }
+  if(p->n<threads){ par_pool_destroy(p); return NULL; }
+  return p;
+}
+
+static int par_threads(int threads, int n){
+  if(threads>PAR_MAX_THREADS) threads=PAR_MAX_THREADS;
+  if(threads>n) threads=n;
+  return threads<1? 1 : threads;
+}
+
+static void par_for(int threads, int n, ParFn fn, void *ctx){
+  if(n<=0) return;
+  threads=par_threads(threads,n);
+  if(threads==1){ fn(ctx,0,n,0); return; }
+  ParPool *p=par_pool;
+  if(p && !p->busy && p->n>=threads){
+    p->busy=1;
+    pthread_mutex_lock(&p->mu);
+    p->fn=fn; p->ctx=ctx; p->len=n; p->chunks=threads; p->pending=p->n-1; p->gen++;
+    pthread_cond_broadcast(&p->go);
+    pthread_mutex_unlock(&p->mu);
+    fn(ctx,0,par_lo(n,1,threads),0);
+    pthread_mutex_lock(&p->mu);
+    while(p->pending>0) pthread_cond_wait(&p->done,&p->mu);
+    pthread_mutex_unlock(&p->mu);
+    p->busy=0;
+    return;
+  }
+  ParTask task[PAR_MAX_THREADS]; pthread_t tid[PAR_MAX_THREADS];
+  for(int t=0;t<threads;t++){ task[t].fn=fn; task[t].ctx=ctx; task[t].tid=t; task[t].lo=par_lo(n,t,threads); task[t].hi=par_lo(n,t+1,threads); }
+  for(int t=1;t<threads;t++) pthread_create(&tid[t],NULL,par_task_run,&task[t]);
+  fn(ctx,task[0].lo,task[0].hi,0);
+  for(int t=1;t<threads;t++) pthread_join(tid[t],NULL);
+}
+
+/* ---------------- Workspace arena ----------------
+   Bump allocator over one block. With base==NULL it only counts, so running a layout
+   function once without memory gives the exact size to reserve (or to declare as a
+   static buffer on the MCU), and running it again carves the real pointers. */
+#define ARENA_ALIGN 64
+
+typedef struct { char *base; size_t cap, top, peak; } Arena;
+
+static void *arena_alloc(Arena *a, size_t bytes){
+  size_t off=(a->top + ARENA_ALIGN-1) & ~(size_t)(ARENA_ALIGN-1);
+  a->top=off+bytes; if(a->top>a->peak) a->peak=a->top;
+  if(!a->base) return NULL;
+  if(a->top>a->cap){ fprintf(stderr,"workspace overflow (%zu > %zu bytes)\n", a->top, a->cap); abort(); }
+  return a->base+off;
+}
+static size_t arena_mark(const Arena *a){ return a->top; }
+static void arena_release(Arena *a, size_t mark){ a->top=mark; }
+static void arena_sizing(Arena *a){ a->base=NULL; a->cap=a->top=a->peak=0; }
+/* base must be ARENA_ALIGN-aligned; the counted sizes assume it. */
+static void arena_attach(Arena *a, void *base, size_t cap){ a->base=(char*)base; a->cap=cap; a->top=a->peak=0; }
+static void *arena_block(size_t bytes){ return aligned_alloc(ARENA_ALIGN, (bytes + ARENA_ALIGN-1) & ~(size_t)(ARENA_ALIGN-1)); }
+
+#define ARENA_NEW(a,type,n) ((type*)arena_alloc((a), sizeof(type)*(size_t)(n)))
+
+void rfd_defaults(Config *c, BearingGeom *g){
+  c->fs=51200.0; c->duration_s=4.0; c->band_lo=4000.0; c->band_hi=8000.0;
+  c->nperseg=65536; c->taps=257; c->enable_order=0; c->q15simulate=0; c->fixed=0;
+  c->stream=0; c->emit_every=8;
+  c->input[0]='\0'; strcpy(c->out_json,"diagnostic.json"); strcpy(c->name,"run"); c->synth[0]='\0'; c->pod_id=-1;
+  c->batch[0]='\0'; c->threads=(int)sysconf(_SC_NPROCESSORS_ONLN); if(c->threads<1) c->threads=1; c->batch_sweep=0; c->simd=Q15K_AUTO; c->decimate=0; c->decim_used=1; c->ws_query=0; c->profile=0;
+  c->nmore=0; c->sweep_pct=0.0; c->sweep_steps=0; c->auto_band=0; c->kurt_levels=0;
+  c->gate=0; c->gate_th[0]=0.0; c->gate_th[1]=0.0; c->gate_th[2]=6.0; c->gate_th[3]=4.0; c->gate_dev=4.0; c->gate_every=16; c->gate_state[0]='\0';
+  c->serve[0]='\0'; c->serve_pods=64; c->serve_windows=0; c->serve_stats=10.0;
+  c->features=0; c->trend_log[0]='\0'; c->trend[0]='\0'; c->trend_asset=-1; c->trend_since=c->trend_until=0.0; c->trend_bins=30;
+  c->export_file[0]='\0'; c->export_quant[0]='\0'; c->patch_t=c->patch_b=0; c->patch_lo=5.0; c->patch_hi=1000.0;
+  g->n=8; g->d=0.010; g->D=0.050; g->beta=0.0; g->rpm=1800.0; strcpy(g->name,"b0");
+}
+
+/* Geometry */
+static double fr_hz(const BearingGeom *g){ return g->rpm / 60.0; }
+static double bpfo_hz(const BearingGeom *g){
+  return 0.5 * g->n * fr_hz(g) * (1.0 - (g->d/g->D) * cos(g->beta));
+}
+static double bpfi_hz(const BearingGeom *g){
+  return 0.5 * g->n * fr_hz(g) * (1.0 + (g->d/g->D) * cos(g->beta));
+}
+static double bsf_hz(const BearingGeom *g){
+  double ratio = (g->d/g->D) * cos(g->beta);
+  return (g->D/(2.0*g->d)) * fr_hz(g) * (1.0 - ratio*ratio);
+}
+static double ftf_hz(const BearingGeom *g){
+  return 0.5 * fr_hz(g) * (1.0 - (g->d/g->D) * cos(g->beta));
+}
+
+/* ---------------- Float DSP path ---------------- */
+typedef struct { double re, im; } cplx;
+
+static void hann_window(double *w, int N){ for(int n=0;n<N;n++) w[n]=0.5*(1.0 - cos(2*M_PI*n/(N-1))); }
+
+/* Mixed-radix lengths: every FFT here is a product of 2, 3 and 5 (the packed real
+   transforms also need N even), so captures and --nperseg values like 51200 run at
+   their real length instead of being zero-padded to a power of two. */
+#define FFT_MAX_FACTORS 40
+
+/* Radices of n, innermost stage first: 4s (if use4) and 2s, then 3s, then 5s.
+   Returns the count, or -1 if n has another prime factor. */
+static int fft_factor(int n, int use4, int *f){
+  int nf=0;
+  if(use4) while(n%4==0){ f[nf++]=4; n/=4; }
+  while(n%2==0){ f[nf++]=2; n/=2; }
+  while(n%3==0){ f[nf++]=3; n/=3; }
+  while(n%5==0){ f[nf++]=5; n/=5; }
+  return n==1? nf : -1;
+}
+
+/* Digit reversal for the stage order of f: a decimation-in-time transform reads its
+   input as a[p] = x[rev[p]]. For powers of two with radix 2 this is bit reversal. */
+static void fft_digit_rev(int *rev, int n, const int *f, int nf){
+  for(int p=0;p<n;p++){
+    int q=p, m=n, r=0, mult=1;
+    for(int s=nf-1;s>=0;s--){ m/=f[s]; r+=(q/m)*mult; q%=m; mult*=f[s]; }
+    rev[p]=r;
+  }
+}
+
+/* FFT plan: digit-reversal and twiddle tables built once per size N and reused by every
+   call. Twiddles are evaluated directly (no recurrence), so there is no phase drift at
+   large N. The packed real transforms of length N run on an N/2 complex FFT whose stage
+   twiddles W_{N/2}^e are W_N^{2e}, read from the same table. */
+typedef struct {
+  int   N;
+  int   nf, f[FFT_MAX_FACTORS];  // radices of the N/2-point complex FFT, innermost first
+  int  *rev;   // digit-reversal permutation of 0..N/2-1
+  cplx *tw;    // tw[k] = exp(-2*pi*i*k/N), k < N/2
+} FftPlan;
+
+static FftPlan *fft_plan_create(int N){
+  int f[FFT_MAX_FACTORS], nf=fft_factor(N/2,1,f);
+  if(!fft_len_ok(N) || nf<0) return NULL;
+  FftPlan *p=(FftPlan*)malloc(sizeof(FftPlan)); p->N=N; p->nf=nf; memcpy(p->f,f,sizeof(int)*nf);
+  p->rev=(int*)malloc(sizeof(int)*(N/2)); fft_digit_rev(p->rev,N/2,f,nf);
+  p->tw=(cplx*)malloc(sizeof(cplx)*(N/2));
+  for(int k=0;k<N/2;k++){ double a=-2*M_PI*k/N; p->tw[k].re=cos(a); p->tw[k].im=sin(a); }
+  return p;
+}
+
+static void fft_plan_destroy(FftPlan *p){ if(!p) return; free(p->rev); free(p->tw); free(p); }
+
+/* Q15 counterpart: N-point complex transform, radix 2 stages first (so powers of two
+   reduce to the plain radix-2 FFT), tables shared from the setup cache. */
+typedef struct { int N, nf, f[FFT_MAX_FACTORS]; const int *rev; const q15c *tw; } Q15Fft;
+
+/* W_N^e for 0 <= e < N from the half table (W_N^{e+N/2} = -W_N^e), conjugated for dir<0. */
+static inline cplx fft_tw(const FftPlan *p, int e, int dir){
+  int h=p->N/2; cplx w = e<h? p->tw[e] : (cplx){ -p->tw[e-h].re, -p->tw[e-h].im };
+  if(dir<0) w.im=-w.im;
+  return w;
+}
+
+static inline cplx cmul(cplx a, cplx b){ cplx r={ a.re*b.re - a.im*b.im, a.re*b.im + a.im*b.re }; return r; }
+
+/* In-place mixed-radix DIT FFT of the N/2-point complex sequence a (already in
+   digit-reversed order). No scaling. A stage of radix r over sub-length L does n/r
+   independent butterflies, so stages are split across threads once the transform is
+   large enough to amortise the thread start-up. */
+#define FFT_PAR_MIN (1<<15)
+
+typedef struct { const FftPlan *p; cplx *a; const void *src; int dir, L, r; } FftStage;
+
+static void fft_stage_part(void *c, int lo, int hi, int tid){   // butterflies b = block*L + k
+  FftStage *st=(FftStage*)c; const FftPlan *p=st->p; int L=st->L, r=st->r, dir=st->dir; (void)tid;
+  int ts=p->N/(L*r);                                             // W_{L*r}^{j*k} = W_N^{j*k*ts}
+  const double s3=0.86602540378443864676, c5a=0.30901699437494742410, c5b=-0.80901699437494742410,
+               s5a=0.95105651629515357212, s5b=0.58778525229247312917, sg = dir<0? -1.0 : 1.0;
+  for(int b=lo;b<hi;){
+    int k=b%L, kend=(hi-b < L-k)? k+(hi-b) : L;
+    cplx *base=st->a + (size_t)(b/L)*L*r;
+    for(; k<kend; k++, b++){
+      cplx *x=base+k, v[5]; v[0]=x[0];
+      for(int j=1;j<r;j++) v[j] = k? cmul(x[j*L], fft_tw(p,j*k*ts,dir)) : x[j*L];
+      switch(r){
+        case 2:
+          x[0].re=v[0].re+v[1].re; x[0].im=v[0].im+v[1].im;
+          x[L].re=v[0].re-v[1].re; x[L].im=v[0].im-v[1].im;
+          break;
+        case 4: {
+          cplx t0={ v[0].re+v[2].re, v[0].im+v[2].im }, t1={ v[0].re-v[2].re, v[0].im-v[2].im };
+          cplx t2={ v[1].re+v[3].re, v[1].im+v[3].im }, d={ v[1].re-v[3].re, v[1].im-v[3].im };
+          cplx t3={ sg*d.im, -sg*d.re };                         // -i*d forward, +i*d inverse
+          x[0].re=t0.re+t2.re;   x[0].im=t0.im+t2.im;
+          x[L].re=t1.re+t3.re;   x[L].im=t1.im+t3.im;
+          x[2*L].re=t0.re-t2.re; x[2*L].im=t0.im-t2.im;
+          x[3*L].re=t1.re-t3.re; x[3*L].im=t1.im-t3.im;
+          break; }
+        case 3: {
+          cplx t1={ v[1].re+v[2].re, v[1].im+v[2].im }, t2={ v[1].re-v[2].re, v[1].im-v[2].im };
+          cplx m={ v[0].re-0.5*t1.re, v[0].im-0.5*t1.im }, q={ sg*s3*t2.im, -sg*s3*t2.re };
+          x[0].re=v[0].re+t1.re; x[0].im=v[0].im+t1.im;
+          x[L].re=m.re+q.re;     x[L].im=m.im+q.im;
+          x[2*L].re=m.re-q.re;   x[2*L].im=m.im-q.im;
+          break; }
+        case 5: {
+          cplx a1={ v[1].re+v[4].re, v[1].im+v[4].im }, b1={ v[1].re-v[4].re, v[1].im-v[4].im };
+          cplx a2={ v[2].re+v[3].re, v[2].im+v[3].im }, b2={ v[2].re-v[3].re, v[2].im-v[3].im };
+          cplx m1={ v[0].re+c5a*a1.re+c5b*a2.re, v[0].im+c5a*a1.im+c5b*a2.im };
+          cplx m2={ v[0].re+c5b*a1.re+c5a*a2.re, v[0].im+c5b*a1.im+c5a*a2.im };
+          cplx n1={ s5a*b1.re+s5b*b2.re, s5a*b1.im+s5b*b2.im }, n2={ s5b*b1.re-s5a*b2.re, s5b*b1.im-s5a*b2.im };
+          x[0].re=v[0].re+a1.re+a2.re; x[0].im=v[0].im+a1.im+a2.im;
+          x[L].re=m1.re+sg*n1.im;   x[L].im=m1.im-sg*n1.re;      // m - i*n forward
+          x[4*L].re=m1.re-sg*n1.im; x[4*L].im=m1.im+sg*n1.re;
+          x[2*L].re=m2.re+sg*n2.im; x[2*L].im=m2.im-sg*n2.re;
+          x[3*L].re=m2.re-sg*n2.im; x[3*L].im=m2.im+sg*n2.re;
+          break; }
+      }
+    }
+  }
+}
+
+static void fft_core(const FftPlan *p, cplx *a, int dir, int threads){
+  int n=p->N/2; if(n<FFT_PAR_MIN) threads=1;
+  FftStage st={ p, a, NULL, dir, 1, 0 };
+  for(int s=0;s<p->nf;s++){ st.r=p->f[s]; par_for(threads,n/st.r,fft_stage_part,&st); st.L*=st.r; }
+}
+
+/* Digit-reversed loads: rfft packs z[m] = x[2m] + i*x[2m+1]; irfft reorders a spectrum. */
+static void fft_load_real_part(void *c, int lo, int hi, int tid){
+  FftStage *st=(FftStage*)c; const double *x=(const double*)st->src; const int *rev=st->p->rev; (void)tid;
+  for(int i=lo;i<hi;i++){ int m=rev[i]; st->a[i].re=x[2*m]; st->a[i].im=x[2*m+1]; }
+}
+static void fft_load_cplx_part(void *c, int lo, int hi, int tid){
+  FftStage *st=(FftStage*)c; const cplx *x=(const cplx*)st->src; const int *rev=st->p->rev; (void)tid;
+  for(int i=lo;i<hi;i++) st->a[i]=x[rev[i]];
+}
+
+/* Real-input forward FFT: x[0..N-1] -> X[0..N/2] (N/2+1 bins). */
+static void rfft_exec(const FftPlan *p, const double *x, cplx *X, int threads){
+  int h=p->N/2, T = h<FFT_PAR_MIN? 1 : threads;
+  FftStage ld={ p, X, x, 0, 0, 0 };
+  par_for(T,h,fft_load_real_part,&ld);
+  fft_core(p,X,+1,threads);
+  cplx z0=X[0]; X[0].re=z0.re+z0.im; X[0].im=0.0; X[h].re=z0.re-z0.im; X[h].im=0.0;
+  for(int k=1;k<=h/2;k++){
+    cplx a=X[k], b=X[h-k], w=p->tw[k];
+    double er=0.5*(a.re+b.re), ei=0.5*(a.im-b.im);     // even part  (Z[k]+conj Z[h-k])/2
+    double or_=0.5*(a.im+b.im), oi=-0.5*(a.re-b.re);   // odd part   (Z[k]-conj Z[h-k])/2i
+    double tr=w.re*or_ - w.im*oi, ti=w.re*oi + w.im*or_;
+    X[k].re=er+tr; X[k].im=ei+ti;
+    X[h-k].re=er-tr; X[h-k].im=-(ei-ti);
+  }
+}
+
+/* Real-output inverse FFT: Hermitian X[0..N/2] -> x[0..N-1], scaled by 1/N. X is clobbered;
+   x doubles as the N/2-point complex work array. */
+static void irfft_exec(const FftPlan *p, cplx *X, double *x, int threads){
+  int h=p->N/2, T = h<FFT_PAR_MIN? 1 : threads;
+  for(int k=0;k<=h/2;k++){
+    int j=h-k;
+    cplx a=X[k], b=X[j];
+    double er=0.5*(a.re+b.re), ei=0.5*(a.im-b.im);
+    double dr=0.5*(a.re-b.re), di=0.5*(a.im+b.im);
+    cplx w=p->tw[k];                                     // O[k] = d * conj(W^k)
+    double or_=dr*w.re + di*w.im, oi=di*w.re - dr*w.im;
+    X[k].re=er-oi; X[k].im=ei+or_;                       // Z[k] = E + iO
+    if(k>0 && j!=k){                                     // E[j]=conj E[k], O[j]=conj O[k]
+      X[j].re=er+oi; X[j].im=-ei+or_;
+    }
+  }
+  cplx *z=(cplx*)x;
+  FftStage ld={ p, z, X, 0, 0, 0 };
+  par_for(T,h,fft_load_cplx_part,&ld);
+  fft_core(p,z,-1,threads);
+  double inv=1.0/h;
+  for(int i=0;i<2*h;i++) x[i]*=inv;
+}
+
+static void fir_bandpass(double *h, int taps, double fs, double f1, double f2){
+  int M=taps-1;
+  double fc1=f1/fs, fc2=f2/fs;
+  for(int n=0;n<taps;n++){
+    double m=n - M/2.0;
+    double w=0.54 - 0.46*cos(2*M_PI*n/M);
+    double h1 = (m==0.0)? 2*fc2 : sin(2*M_PI*fc2*m)/(M_PI*m);
+    double h2 = (m==0.0)? 2*fc1 : sin(2*M_PI*fc1*m)/(M_PI*m);
+    h[n]=w*(h1-h2);
+  }
+  double s=0.0; for(int i=0;i<taps;i++) s+=h[i]; if(s!=0.0){ for(int i=0;i<taps;i++) h[i]/=s; }
+}
+
+/* Half-band low-pass (cutoff fs/4, Blackman window) for the 2:1 decimator stages.
+   Even offsets from the centre are exactly zero; DC gain is 1. */
+static void fir_halfband(double *h, int taps){
+  int c=taps/2;
+  for(int n=0;n<taps;n++){
+    int m=n-c;
+    double w=0.42 - 0.5*cos(2*M_PI*n/(taps-1)) + 0.08*cos(4*M_PI*n/(taps-1));
+    h[n] = m==0? 0.5 : (m%2==0? 0.0 : w*sin(0.5*M_PI*m)/(M_PI*m));
+    if(m==0) h[n]*=w;
+  }
+  double s=0.0; for(int i=0;i<taps;i++) s+=h[i]; for(int i=0;i<taps;i++) h[i]/=s;
+}
+
+typedef struct {
+  const FftPlan *p; const double *x; int N; const double *h; int L; double *y;
+  const cplx *H;                   // overlap-save: filter spectrum
+  const q15 *xq, *hq; q15 *yq;     // Q15 variants
+  const q15 *hr;                   // Q15 direct form: taps reversed for the dot kernel
+  cplx *X; double *blk;            // overlap-save: per-thread block spectrum and samples
+} FirJob;
+
+static void conv_fir_part(void *c, int lo, int hi, int tid){
+  FirJob *j=(FirJob*)c; const double *x=j->x, *h=j->h; int L=j->L; (void)tid;
+  for(int n=lo;n<hi;n++){
+    int kmax = n<L-1 ? n : L-1;   // causal: only x[0..n] contribute
+    double acc=0.0;
+    for(int k=0;k<=kmax;k++) acc+=h[k]*x[n-k];
+    j->y[n]=acc;
+  }
+}
+
+static void conv_fir(const double *x, int N, const double *h, int L, double *y, int threads){
+  FirJob j={ .x=x, .N=N, .h=h, .L=L, .y=y };
+  par_for(threads,N,conv_fir_part,&j);
+}
+
+/* Fast convolution (overlap-save). Same causal alignment as conv_fir():
+   y[n] = sum_k h[k] x[n-k], x[<0]=0, so the (L-1)/2 group delay is unchanged.
+   Output blocks are independent and are split across threads. */
+
+static int ols_fft_size(int L){ int M=next_pow2(4*(L-1)); return M<64? 64 : M; }
+
+static void conv_fir_fft_part(void *c, int lo, int hi, int tid){
+  FirJob *j=(FirJob*)c; const FftPlan *p=j->p; int M=p->N, L=j->L, N=j->N, B=M-(L-1), K=M/2+1;
+  cplx *X=j->X + (size_t)tid*K; double *blk=j->blk + (size_t)tid*M;
+  for(int b=lo;b<hi;b++){
+    int n0=b*B;
+    for(int i=0;i<M;i++){ int idx=n0-(L-1)+i; blk[i]=(idx>=0 && idx<N)? j->x[idx] : 0.0; }
+    rfft_exec(p,blk,X,1);
+    for(int k=0;k<K;k++){ double a=X[k].re, bb=X[k].im; X[k].re=a*j->H[k].re - bb*j->H[k].im; X[k].im=a*j->H[k].im + bb*j->H[k].re; }
+    irfft_exec(p,X,blk,1);
+    int cnt = (N-n0<B)? N-n0 : B;
+    for(int i=0;i<cnt;i++) j->y[n0+i]=blk[L-1+i];
+  }
+}
+
+/* Scratch for conv_fir_fft() with up to T threads, M = p->N. */
+typedef struct { cplx *H, *X; double *blk; } FirScratch;
+
+static void fir_scratch_carve(FirScratch *s, Arena *a, int M, int T){
+  s->H=ARENA_NEW(a,cplx,M/2+1); s->X=ARENA_NEW(a,cplx,(size_t)T*(M/2+1)); s->blk=ARENA_NEW(a,double,(size_t)T*M);
+}
+
+static void conv_fir_fft(const FftPlan *p, const double *x, int N, const double *h, int L, double *y, int threads, const FirScratch *sc){
+  int M=p->N, B=M-(L-1);
+  for(int k=0;k<M;k++) sc->blk[k]= k<L? h[k] : 0.0;
+  rfft_exec(p,sc->blk,sc->H,1);
+  FirJob j={ .p=p, .x=x, .N=N, .h=h, .L=L, .y=y, .H=sc->H, .X=sc->X, .blk=sc->blk };
+  par_for(threads,(N+B-1)/B,conv_fir_fft_part,&j);
+}
+
+/* fir_plan is NULL for direct form, else a plan of size ols_fft_size(L). */
+static void fir_filter(const FftPlan *fir_plan, const double *x, int N, const double *h, int L, double *y, int threads, const FirScratch *sc){
+  if(fir_plan) conv_fir_fft(fir_plan,x,N,h,L,y,threads,sc); else conv_fir(x,N,h,L,y,threads);
+}
+
+/* Hilbert envelope |x + i*H{x}|. H{x} is real, so both transforms are packed real FFTs:
+   H{x} = irfft(-i*sgn(k)*X[k]) with DC and Nyquist zeroed. */
+static void envelope_fft_float(const FftPlan *p, const double *x, int N, double *env, int threads, cplx *X, double *hx){
+  rfft_exec(p,x,X,threads);
+  X[0].re=X[0].im=0.0; X[N/2].re=X[N/2].im=0.0;
+  for(int k=1;k<N/2;k++){ double re=X[k].re; X[k].re=X[k].im; X[k].im=-re; }
+  irfft_exec(p,X,hx,threads);
+  for(int i=0;i<N;i++){ env[i]=hypot(x[i], hx[i]); }
+}
+
+/* Welch segments are independent: each thread sums its contiguous run of segments into
+   its own accumulator, and the partial sums are added in thread order. */
+typedef struct {
+  double *acc, *seg; cplx *spec;          // float: T x K sums, T x n windowed segment, T x K spectrum
+  int64_t *iacc; q15c *bufq, *wq; q15 *winq;   // Q15: T x K sums, T x n FFT buffer, T x n/2 twiddles, T x n product
+} WelchScratch;
+
+static void welch_scratch_carve(WelchScratch *s, Arena *a, int n, int T, int fixed){
+  int K=n/2+1; memset(s,0,sizeof(*s));
+  if(fixed){ s->iacc=ARENA_NEW(a,int64_t,(size_t)T*K); s->bufq=ARENA_NEW(a,q15c,(size_t)T*n); s->wq=ARENA_NEW(a,q15c,(size_t)T*(n/2>1? n/2 : 1)); s->winq=ARENA_NEW(a,q15,(size_t)T*n); }
+  else { s->acc=ARENA_NEW(a,double,(size_t)T*K); s->seg=ARENA_NEW(a,double,(size_t)T*n); s->spec=ARENA_NEW(a,cplx,(size_t)T*K); }
+}
+
+/* Optional per-segment band energies (the --export-patch STFT): band b sums |X[k]|^2 over
+   bins bk[2b] <= k < bk[2b+1]; segment s writes row s of seg (first nseg segments). */
+typedef struct { const int *bk; int nb, nseg; double *seg; } WelchBands;
+
+typedef struct {
+  const FftPlan *p; const double *win; const double *x; int nperseg, step;
+  const q15 *winq; const q15 *xq; const Q15Fft *qf;
+  const WelchScratch *sc;
+  const WelchBands *bands;
+} WelchJob;
+
+static void welch_float_part(void *c, int lo, int hi, int tid){
+  WelchJob *j=(WelchJob*)c; int n=j->nperseg, K=n/2+1;
+  double *acc=j->sc->acc + (size_t)tid*K, *seg=j->sc->seg + (size_t)tid*n; cplx *buf=j->sc->spec + (size_t)tid*K;
+  for(int s=lo;s<hi;s++){
+    const double *xs=j->x + (size_t)s*j->step;
+    for(int i=0;i<n;i++){ seg[i]=xs[i]*j->win[i]; }
+    rfft_exec(j->p,seg,buf,1);
+    for(int k=0;k<K;k++){ double a=buf[k].re, b=buf[k].im; acc[k]+=a*a+b*b; }
+    const WelchBands *wb=j->bands;
+    if(wb && s<wb->nseg) for(int b=0;b<wb->nb;b++){
+      double e=0.0; for(int k=wb->bk[2*b];k<wb->bk[2*b+1];k++) e+=buf[k].re*buf[k].re + buf[k].im*buf[k].im;
+      wb->seg[(size_t)s*wb->nb+b]=e;
+    }
+  }
+}
+
+static void welch_reduce(const double *acc, int threads, int K, double *Pxx){
+  for(int t=0;t<threads;t++){ const double *a=acc+(size_t)t*K; for(int k=0;k<K;k++) Pxx[k]+=a[k]; }
+}
+
+static void welch_psd_float(const FftPlan *p, const double *win, const double *x, int N, int nperseg, int noverlap,
+                            double fs, double *freqs, double *Pxx, int threads, const WelchScratch *sc, const WelchBands *wb){
+  int step=nperseg - noverlap;
+  int segments=(N - noverlap)/step;
+  if(segments<=0) segments=1;
+  double win_pow=0.0; for(int i=0;i<nperseg;i++){ win_pow += win[i]*win[i]; }
+  for(int k=0;k<=nperseg/2;k++){ freqs[k]=(fs*k)/nperseg; Pxx[k]=0.0; }
+  int full=0; while(full<segments && full*step+nperseg<=N) full++;   // segments that fit
+  int T=par_threads(threads,full), K=nperseg/2+1;
+  memset(sc->acc,0,sizeof(double)*(size_t)T*K);
+  WelchJob j={ p, win, x, nperseg, step, NULL, NULL, NULL, sc, wb };
+  par_for(T,full,welch_float_part,&j);
+  welch_reduce(sc->acc,T,K,Pxx);
+  for(int k=0;k<=nperseg/2;k++){ Pxx[k]/=segments; Pxx[k]/=win_pow; Pxx[k]*=2.0; Pxx[k]/=fs; }
+  Pxx[0]*=0.5; if(nperseg%2==0) Pxx[nperseg/2]*=0.5;
+}
+
+/* Peak detection */
+#define DET_TOL_REL      0.02   // relative search window around a predicted line
+#define DET_MAX_HARMONIC 3      // BPFO/BPFI are also searched at 2x and 3x
+#define DET_GUARD        3      // bins excluded around a peak when estimating noise
+#define DET_RING_BINS    (10*DET_GUARD)   // noise ring half-width
+
+/* Every local maximum of the spectrum, in bin (= frequency) order. Built in one pass;
+   each target, harmonic or sideband query is then a binary search over the peaks instead
+   of a scan over all K bins. Only the few hits that are queried need a noise ring, so
+   each one sums its 60 bins directly: prefix sums over the whole PSD lose the ring to
+   cancellation against the DC bin. */
+typedef struct {
+  const double *f, *P; int K;
+  int *pk, npk;       // local maxima (bin indices, ascending); at most K/2
+} PeakTable;
+
+static void peak_table_carve(PeakTable *t, Arena *a, int K){
+  t->pk=ARENA_NEW(a,int,K/2+1); t->K=K; t->npk=0;
+}
+
+static void peak_table_build(PeakTable *t, const double *freqs, const double *Pxx, int K){
+  t->f=freqs; t->P=Pxx; t->K=K; t->npk=0;
+  for(int i=1;i<K-1;i++) if(Pxx[i]>Pxx[i-1] && Pxx[i]>Pxx[i+1]) t->pk[t->npk++]=i;
+}
+
+static double snr_db_ring(const PeakTable *t, int idx){
+  int lo=idx-DET_RING_BINS; if(lo<0) lo=0; int hi=idx+DET_RING_BINS; if(hi>=t->K) hi=t->K-1;
+  double sum=0.0; int cnt=0;
+  for(int i=lo;i<=hi;i++){ if(i>=idx-DET_GUARD && i<=idx+DET_GUARD) continue; sum+=t->P[i]; cnt++; }
+  double noise=(cnt>0? sum/cnt : 1e-20); if(noise<1e-20) noise=1e-20;
+  return 10.0*log10(t->P[idx]/noise);
+}
+
+/* Strongest peak within tol_rel of target (first one on ties), kept if its ring SNR
+   reaches min_snr_db. */
+static PeakHit peak_query(const PeakTable *t, double target, double tol_rel, double min_snr_db){
+  PeakHit h={0,0,0,0,0,0}; if(target<=0 || t->npk==0) return h;
+  double df=t->f[1]-t->f[0], f_lo=target*(1.0-tol_rel)-df, f_hi=target*(1.0+tol_rel)+df;   // one bin of slack; the exact test is below
+  int lo=0, hi=t->npk;
+  while(lo<hi){ int mid=(lo+hi)/2; if(t->f[t->pk[mid]]<f_lo) lo=mid+1; else hi=mid; }
+  double best_amp=-1; int best_idx=-1;
+  for(int j=lo; j<t->npk && t->f[t->pk[j]]<=f_hi; j++){
+    int i=t->pk[j];
+    if(fabs(t->f[i]-target)/target<=tol_rel && t->P[i]>best_amp){ best_amp=t->P[i]; best_idx=i; }
+  }
+  if(best_idx>=0){
+    h.index=best_idx; h.freq=t->f[best_idx]; h.snr_db=snr_db_ring(t,best_idx); h.df=df; h.harmonic=0; h.found=(h.snr_db>=min_snr_db);
+  }
+  return h;
+}
+
+/* t: peak table of the spectrum (peak_table_build). */
+static void detect_hz(const BearingGeom *g, const PeakTable *t, Detections *d){
+  d->fr=fr_hz(g); d->bpfo=bpfo_hz(g); d->bpfi=bpfi_hz(g); d->bsf=bsf_hz(g); d->ftf=ftf_hz(g);
+
+  const double TOL_REL=DET_TOL_REL, MIN_SNR_DB=6.0;
+  d->hz_bpfo = peak_query(t,d->bpfo,TOL_REL,MIN_SNR_DB);
+  d->hz_bpfi = peak_query(t,d->bpfi,TOL_REL,MIN_SNR_DB);
+  d->hz_bsf  = peak_query(t,d->bsf, TOL_REL,MIN_SNR_DB);
+  d->hz_ftf  = peak_query(t,d->ftf, TOL_REL,MIN_SNR_DB);
+  if(!d->hz_bpfo.found){ for(int H=2;H<=DET_MAX_HARMONIC;H++){ PeakHit hit=peak_query(t,H*d->bpfo,TOL_REL,MIN_SNR_DB); if(hit.found){ hit.harmonic=H; d->hz_bpfo=hit; break; } } }
+  if(!d->hz_bpfi.found){ for(int H=2;H<=DET_MAX_HARMONIC;H++){ PeakHit hit=peak_query(t,H*d->bpfi,TOL_REL,MIN_SNR_DB); if(hit.found){ hit.harmonic=H; d->hz_bpfi=hit; break; } } }
+
+  d->fault="unknown"; d->conf=0.0;
+  double score=0.0; if(d->hz_bpfo.found) score=fmax(score, (d->hz_bpfo.snr_db - 6.0)/12.0); score=clamp(score,0.0,1.0);
+  if(score>0.0){ d->fault="outer_race"; d->conf=score; strcpy(d->rationale,"BPFO matched in spectrum"); }
+  else strcpy(d->rationale,"no characteristic lines matched with SNR");
+}
+
+/* Every bearing (first --geom, then cfg->more) at every --rpm-sweep speed, matched
+   against one peak table. e[b*steps + k] is bearing b at sweep point k. */
+static int bearing_set_size(const Config *cfg){
+  return (cfg->nmore || cfg->sweep_steps)? (1+cfg->nmore)*(cfg->sweep_steps? cfg->sweep_steps : 1) : 0;
+}
+
+/* best[b]: highest confidence for bearing b, ties going to the speed nearest nominal. */
+static void detect_set(const Config *cfg, const BearingGeom *g, const PeakTable *t, BearingSet *s){
+  s->nb=1+cfg->nmore; s->steps=cfg->sweep_steps? cfg->sweep_steps : 1;
+  for(int b=0;b<s->nb;b++){
+    const BearingGeom *gb = b? &cfg->more[b-1] : g;
+    double best=-1.0, best_off=0.0; s->best[b]=b*s->steps;
+    for(int k=0;k<s->steps;k++){
+      double off = s->steps>1? cfg->sweep_pct/100.0*(2.0*k/(s->steps-1)-1.0) : 0.0;
+      BearingEval *ev=&s->e[b*s->steps+k];
+      ev->g=*gb; ev->g.rpm=gb->rpm*(1.0+off); detect_hz(&ev->g,t,&ev->det);
+      if(ev->det.conf>best || (ev->det.conf==best && fabs(off)<best_off)){ best=ev->det.conf; best_off=fabs(off); s->best[b]=b*s->steps+k; }
+    }
+  }
+}
+
+/* ---------------- Order tracking ----------------
+   The tach is walked once, block by block: each rising edge closes a revolution, whose
+   M equal-angle samples are interpolated from the envelope straight away, so no edge
+   list is kept. Positions are 32.32 fixed point in envelope samples (integer-only on
+   the Q15 path); envelope sample j holds input time j*D - delay, delay being the FIR
+   and decimator group delay. */
+#define ORD_TACH_THRESH 0.5   // tach level between pulse low and high (1 pulse/rev)
+#define ORD_MIN_REVS    4     // shortest order-domain Welch segment, in revolutions
+
+typedef struct {
+  int M, D; long delay;             // samples/rev, envelope decimation, envelope lag [input samples]
+  int hi; long last_edge, t;        // tach level, edge opening the current revolution (-1 none), samples seen
+  long revs; int truncated;         // revolutions resampled; 1 if out filled up (speed far above nominal)
+  long per_min, per_max, per_sum;   // revolution lengths [input samples]
+} AngleResampler;
+
+static void angle_init(AngleResampler *r, int M, int D, long delay){
+  memset(r,0,sizeof(*r)); r->M=M; r->D=D; r->delay=delay; r->last_edge=-1; r->hi=1;   // a revolution starts at the first rising edge
+}
+
+/* Envelope positions p0 + m*step (32.32), m < M; the M interpolations are independent. */
+static void angle_interp(const double *x, uint64_t p0, uint64_t step, int M, double *y){
+  for(int m=0;m<M;m++){
+    uint64_t p=p0+(uint64_t)m*step; size_t i=(size_t)(p>>32); double fr=(double)(uint32_t)p*(1.0/4294967296.0);
+    y[m]=x[i]+(x[i+1]-x[i])*fr;
+  }
+}
+static void angle_interp_q15(const q15 *x, uint64_t p0, uint64_t step, int M, q15 *y){
+  for(int m=0;m<M;m++){
+    uint64_t p=p0+(uint64_t)m*step; size_t i=(size_t)(p>>32); int32_t fr=(int32_t)((uint32_t)p>>17);   // Q15 fraction
+    y[m]=(q15)(x[i] + (((int32_t)(x[i+1]-x[i])*fr + (1<<14)) >> 15));
+  }
+}
+
+/* Next n tach samples; completed revolutions go to out (float or Q15 like env, n_env
+   samples) from *n_out up to cap. */
+static void angle_push(AngleResampler *r, const double *tach, int n, const void *env, long n_env, int fixed,
+                       void *out, long cap, long *n_out){
+  for(int k=0;k<n;k++){
+    int h=tach[k]>ORD_TACH_THRESH; long e=r->t+k;
+    if(h && !r->hi){
+      if(r->last_edge>=0 && !r->truncated){
+        long per=e-r->last_edge;
+        uint64_t p0=((uint64_t)(r->last_edge+r->delay)<<32)/(uint64_t)r->D, step=((uint64_t)per<<32)/((uint64_t)r->D*r->M);
+        long last=(long)((p0+(uint64_t)(r->M-1)*step)>>32);
+        if(*n_out+r->M>cap) r->truncated=1;
+        else if(last+1<n_env){            // else the envelope (delayed) ends inside this revolution
+          if(fixed) angle_interp_q15((const q15*)env,p0,step,r->M,(q15*)out+*n_out);
+          else angle_interp((const double*)env,p0,step,r->M,(double*)out+*n_out);
+          *n_out+=r->M; r->revs++;
+          if(r->revs==1 || per<r->per_min) r->per_min=per;
+          if(per>r->per_max) r->per_max=per;
+          r->per_sum+=per;
+        }
+      }
+      r->last_edge=e;
+    }
+    r->hi=h;
+  }
+  r->t+=n;
+}
+
+/* ---------------- Q15 fixed-point support ---------------- */
+/* Mixed-radix DIT on a (already in digit-reversed order, see Q15Fft.rev). Scaled: each
+   radix-r stage divides by r, so the result is X/N and cannot overflow; unscaled (for an
+   inverse whose output is known to fit) the stages saturate instead. Radix-2 stages gather W_2L^k = W_N^(k*N/2L)
+   from the size-N forward table (conjugated with saturation for the inverse) and run
+   the vector butterfly kernel; radix-3/5 stages are scalar with 32-bit intermediates.
+   The transform is integer-only, and blocks of a stage split across threads
+   bit-exactly. */
+typedef struct { q15c *a; int L, r, inverse, scaled; const q15c *w; const Q15Fft *q; } Q15Stage;
+
+static inline q15c q15_tw(const Q15Fft *q, int e, int inverse){   // W_N^e, 0 <= e < N
+  int h=q->N/2; q15c w = e<h? q->tw[e] : (q15c){ sat16(-(int32_t)q->tw[e-h].re), sat16(-(int32_t)q->tw[e-h].im) };
+  if(inverse) w.im=sat16(-(int32_t)w.im);
+  return w;
+}
+static inline int32_t q15_mulc(int32_t a, int32_t c){ return (a*c + (1<<14)) >> 15; }   // |a| <= 2^16, |c| < 2^15
+
+static void fft_q15_radix2_part(void *c, int lo, int hi, int tid){
+  Q15Stage *st=(Q15Stage*)c; int h=st->L; (void)tid;
+  for(int blk=lo; blk<hi; blk++){
+    q15c *a=st->a + (size_t)blk*2*h;
+    if(st->scaled) q15k->butterfly(a,a+h,st->w,h); else q15k->butterfly_full(a,a+h,st->w,h);
+  }
+}
+
+#define Q15_INV3  10923   // 1/3
+#define Q15_INV5   6554   // 1/5
+#define Q15_S3    28378   // sin(2pi/3)
+#define Q15_C5A   10126   // cos(2pi/5)
+#define Q15_C5B  -26510   // cos(4pi/5)
+#define Q15_S5A   31164   // sin(2pi/5)
+#define Q15_S5B   19261   // sin(4pi/5)
+
+static void fft_q15_radix35_part(void *c, int lo, int hi, int tid){   // butterflies b = block*L + k
+  Q15Stage *st=(Q15Stage*)c; int L=st->L, r=st->r, ts=st->q->N/(L*r), sg=st->inverse? -1 : 1; (void)tid;
+  int32_t inv = r==3? Q15_INV3 : Q15_INV5;
+  for(int b=lo;b<hi;b++){
+    int k=b%L; q15c *x=st->a + (size_t)(b/L)*L*r + k;
+    int32_t vr[5], vi[5];
+    for(int j=0;j<r;j++){
+      q15c v = (j && k)? q15c_mul(x[j*L], q15_tw(st->q,j*k*ts,st->inverse)) : x[j*L];
+      if(st->scaled){ vr[j]=q15_mulc(v.re,inv); vi[j]=q15_mulc(v.im,inv); } else { vr[j]=v.re; vi[j]=v.im; }
+    }
+    if(r==3){
+      int32_t t1r=vr[1]+vr[2], t1i=vi[1]+vi[2], t2r=vr[1]-vr[2], t2i=vi[1]-vi[2];
+      int32_t mr=vr[0]-(t1r>>1), mi=vi[0]-(t1i>>1), qr=sg*q15_mulc(t2i,Q15_S3), qi=-sg*q15_mulc(t2r,Q15_S3);
+      x[0].re=sat16(vr[0]+t1r); x[0].im=sat16(vi[0]+t1i);
+      x[L].re=sat16(mr+qr);     x[L].im=sat16(mi+qi);
+      x[2*L].re=sat16(mr-qr);   x[2*L].im=sat16(mi-qi);
+    } else {
+      int32_t a1r=vr[1]+vr[4], a1i=vi[1]+vi[4], b1r=vr[1]-vr[4], b1i=vi[1]-vi[4];
+      int32_t a2r=vr[2]+vr[3], a2i=vi[2]+vi[3], b2r=vr[2]-vr[3], b2i=vi[2]-vi[3];
+      int32_t m1r=vr[0]+q15_mulc(a1r,Q15_C5A)+q15_mulc(a2r,Q15_C5B), m1i=vi[0]+q15_mulc(a1i,Q15_C5A)+q15_mulc(a2i,Q15_C5B);
+      int32_t m2r=vr[0]+q15_mulc(a1r,Q15_C5B)+q15_mulc(a2r,Q15_C5A), m2i=vi[0]+q15_mulc(a1i,Q15_C5B)+q15_mulc(a2i,Q15_C5A);
+      int32_t n1r=q15_mulc(b1r,Q15_S5A)+q15_mulc(b2r,Q15_S5B), n1i=q15_mulc(b1i,Q15_S5A)+q15_mulc(b2i,Q15_S5B);
+      int32_t n2r=q15_mulc(b1r,Q15_S5B)-q15_mulc(b2r,Q15_S5A), n2i=q15_mulc(b1i,Q15_S5B)-q15_mulc(b2i,Q15_S5A);
+      x[0].re=sat16(vr[0]+a1r+a2r); x[0].im=sat16(vi[0]+a1i+a2i);
+      x[L].re=sat16(m1r+sg*n1i);    x[L].im=sat16(m1i-sg*n1r);      // m - i*n forward
+      x[4*L].re=sat16(m1r-sg*n1i);  x[4*L].im=sat16(m1i+sg*n1r);
+      x[2*L].re=sat16(m2r+sg*n2i);  x[2*L].im=sat16(m2i-sg*n2r);
+      x[3*L].re=sat16(m2r-sg*n2i);  x[3*L].im=sat16(m2i+sg*n2r);
+    }
+  }
+}
+
+/* w: N/2 scratch for the gathered radix-2 twiddles. */
+static void fft_q15(q15c *a, const Q15Fft *q, int inverse, int scaled, int threads, q15c *w){
+  int N=q->N; if(N<FFT_PAR_MIN) threads=1;
+  Q15Stage st={ a, 1, 0, inverse, scaled, w, q };
+  for(int s=0;s<q->nf;s++){
+    st.r=q->f[s];
+    if(st.r==2){
+      int stride=N/(2*st.L);
+      for(int k=0;k<st.L;k++){ w[k]=q->tw[(size_t)k*stride]; if(inverse) w[k].im=sat16(-(int32_t)w[k].im); }
+      par_for(threads,N/(2*st.L),fft_q15_radix2_part,&st);
+    } else par_for(threads,N/st.r,fft_q15_radix35_part,&st);
+    st.L*=st.r;
+  }
+}
+
+/* y[n] = sum_k x[n-k] h[k] is a contiguous dot product of x[n-L+1..n] with the reversed
+   taps; near the start only the tail of hr overlaps x[0..n]. */
+static void fir_q15_part(void *c, int lo, int hi, int tid){
+  FirJob *j=(FirJob*)c; const q15 *x=j->xq, *h=j->hq; int L=j->L; (void)tid;
+  for(int n=lo;n<hi;n++){
+    int kmax = n<L-1 ? n : L-1;
+    int64_t acc=0;
+    if(j->hr) acc=q15k->dot(x+n-kmax, j->hr+(L-1-kmax), kmax+1);
+    else for(int k=0;k<=kmax;k++) acc += (int32_t)x[n-k]*(int32_t)h[k];
+    int32_t r = (int32_t)((acc + (1LL<<14)) >> 15);
+    j->yq[n]=sat16(r);
+  }
+}
+
+/* hr: L scratch for the reversed taps. */
+static void fir_q15(const q15 *x, int N, const q15 *h, int L, q15 *y, int threads, q15 *hr){
+  for(int k=0;k<L;k++){ hr[k]=h[L-1-k]; if(h[k]==-32768){ hr=NULL; break; } }   // outside the dot kernel's range
+  FirJob j={ .N=N, .L=L, .xq=x, .hq=h, .yq=y, .hr=hr };
+  par_for(threads,N,fir_q15_part,&j);
+}
+
+/* |analytic signal| of x into env (may alias x); z and w: N values of scratch each.
+   The forward transform is scaled (X/N), so the inverse runs unscaled and the envelope
+   comes back at the input's amplitude rather than 1/N of it. The inverse runs in w on
+   the digit-reversed spectrum, gathering its twiddles in z. */
+static void envelope_q15(const q15 *x, int N, q15 *env, const Q15Fft *q, int threads, q15c *z, q15c *w){
+  for(int i=0;i<N;i++){ z[i].re=x[q->rev[i]]; z[i].im=0; }
+  fft_q15(z,q,0,1,threads,w);
+  for(int k=1;k<N/2;k++){ int32_t r=(int32_t)z[k].re*2, im=(int32_t)z[k].im*2; z[k].re=sat16(r); z[k].im=sat16(im); }
+  for(int k=N/2+1;k<N;k++){ z[k].re=0; z[k].im=0; }
+  for(int i=0;i<N;i++) w[i]=z[q->rev[i]];
+  fft_q15(w,q,1,0,threads,z);
+  q15k->abs_approx(w,env,N);
+}
+
+/* Integer Welch: |X[k]|^2 of two Q15 parts is a Q30 value below 2^31, summed per thread
+   in 64 bits. Integer addition is associative, so the spectrum does not depend on the
+   thread count; conversion to physical units happens once per spectrum. */
+static void welch_q15_part(void *c, int lo, int hi, int tid){
+  WelchJob *j=(WelchJob*)c; int n=j->nperseg, K=n/2+1;
+  int64_t *acc=j->sc->iacc + (size_t)tid*K;
+  q15c *buf=j->sc->bufq + (size_t)tid*n, *w=j->sc->wq + (size_t)tid*(n/2>1? n/2 : 1); q15 *win=j->sc->winq + (size_t)tid*n;
+  for(int s=lo;s<hi;s++){
+    const q15 *xs=j->xq + (size_t)s*j->step;
+    q15k->mul(xs, j->winq, win, n);
+    for(int i=0;i<n;i++){ buf[i].re=win[j->qf->rev[i]]; buf[i].im=0; }
+    fft_q15(buf,j->qf,0,1,1,w);
+    for(int k=0;k<K;k++) acc[k] += (int64_t)buf[k].re*buf[k].re + (int64_t)buf[k].im*buf[k].im;
+    const WelchBands *wb=j->bands;
+    if(wb && s<wb->nseg) for(int b=0;b<wb->nb;b++){
+      int64_t e=0; for(int k=wb->bk[2*b];k<wb->bk[2*b+1];k++) e += (int64_t)buf[k].re*buf[k].re + (int64_t)buf[k].im*buf[k].im;
+      wb->seg[(size_t)s*wb->nb+b]=(double)e;
+    }
+  }
+}
+
+static void welch_psd_q15(const q15 *win, const Q15Fft *qf, const q15 *x, int N, int nperseg, int noverlap,
+                          double fs, double *freqs, double *Pxx, int threads, const WelchScratch *sc, const WelchBands *wb){
+  int step=nperseg - noverlap; int segments=(N - noverlap)/step; if(segments<=0) segments=1;
+  int64_t win_pow=0; for(int i=0;i<nperseg;i++) win_pow += (int32_t)win[i]*win[i];   // Q30
+  int full=0; while(full<segments && full*step+nperseg<=N) full++;
+  int T=par_threads(threads,full), K=nperseg/2+1;
+  memset(sc->iacc,0,sizeof(int64_t)*(size_t)T*K);
+  WelchJob j={ NULL, NULL, NULL, nperseg, step, win, x, qf, sc, wb };
+  par_for(T,full,welch_q15_part,&j);
+  for(int t=1;t<T;t++){ const int64_t *a=sc->iacc+(size_t)t*K; for(int k=0;k<K;k++) sc->iacc[k]+=a[k]; }
+  double scale=2.0/((double)segments*(double)win_pow*fs);   // Q30 factors of power and window cancel
+  for(int k=0;k<K;k++){ freqs[k]=(fs*k)/nperseg; Pxx[k]=(double)sc->iacc[k]*scale; }
+  Pxx[0]*=0.5; if(nperseg%2==0) Pxx[nperseg/2]*=0.5;
+}
+
+/* ---------------- Post-envelope decimation ----------------
+   The detector only looks at bins up to the highest fault harmonic, so the envelope is
+   decimated by D (a cascade of 2:1 half-band stages) and Welch runs with nperseg/D at
+   fs/D: same bin spacing, 1/D of the FFT work. State persists between calls, so the
+   one-shot and streaming paths share the code. */
+#define DEC_TAPS       79     // longest half-band stage
+#define DEC_MAX_STAGES 6      // up to 64x
+#define DEC_PASS       0.4    // usable bandwidth after decimation, fraction of fs_out
+#define DEC_MIN_SEG    64     // smallest Welch segment after decimation
+
+/* Largest power-of-two factor that keeps every searched line and its noise ring in the
+   passband (same search limits as detect_hz, over all bearings and speeds matched), and
+   nperseg/D even. */
+static double search_top_hz(const BearingGeom *g){
+  return fmax(fmax(DET_MAX_HARMONIC*bpfo_hz(g), DET_MAX_HARMONIC*bpfi_hz(g)), fmax(bsf_hz(g), ftf_hz(g)));
+}
+
+// every bearing, at the top of the rpm sweep
+static double search_top_all(const Config *cfg, const BearingGeom *g){
+  double f_top = search_top_hz(g);
+  for(int b=0;b<cfg->nmore;b++) f_top=fmax(f_top, search_top_hz(&cfg->more[b]));
+  if(cfg->sweep_steps) f_top*=1.0+cfg->sweep_pct/100.0;
+  return f_top;
+}
+
+static int decim_auto(const Config *cfg, const BearingGeom *g, double fs, int nperseg){
+  double f_top = search_top_all(cfg,g)*(1.0+DET_TOL_REL) + DET_RING_BINS*fs/nperseg;
+  int D=1;
+  while(D*2 <= (1<<DEC_MAX_STAGES) && DEC_PASS*fs/(D*2) >= f_top && nperseg/(D*2) >= DEC_MIN_SEG && nperseg%(D*4)==0) D*=2;
+  return D;
+}
+
+/* --decimate: 0 auto, else the requested factor bounded by the segment length (and
+   dividing it into an even number of points). */
+static int decim_factor(const Config *cfg, const BearingGeom *g, double fs, int nperseg){
+  if(cfg->decimate==0) return decim_auto(cfg,g,fs,nperseg);
+  int D=cfg->decimate; while(D>1 && (nperseg/D < DEC_MIN_SEG || nperseg%(2*D))) D/=2;
+  return D;
+}
+
+typedef struct {
+  int stages, fixed;
+  int L[DEC_MAX_STAGES], phase[DEC_MAX_STAGES];   // taps per stage; 0 when the next input is kept
+  double *h[DEC_MAX_STAGES], *hist[DEC_MAX_STAGES], *buf;   // float: taps, last L-1 inputs, [history | block]
+  q15 *hq[DEC_MAX_STAGES], *histq[DEC_MAX_STAGES], *bufq;   // Q15 equivalents
+} Decimator;
+
+/* Stage s of a 2^S cascade only has to protect the final passband (DEC_PASS*fs/D), so
+   its transition band is 0.5 - 2*DEC_PASS*2^s/D of its input rate: wide (short filter)
+   early on, DEC_TAPS-class only in the last stage. Lengths are 4k+3 so the centre tap
+   is odd and the half-band zeros fall on the odd taps. */
+static int decim_stage_taps(int s, int stages){
+  double dw=0.5 - 2.0*DEC_PASS*(double)(1<<s)/(1<<stages);
+  int L=(int)ceil(5.5/dw);                 // Blackman: ~74 dB stopband
+  while(L%4!=3) L++;
+  return L>DEC_TAPS? DEC_TAPS : L;
+}
+
+/* Carves taps, history and the block buffer (cap = largest block passed to
+   decim_run*()) from the arena; with a sizing arena only the bytes are counted. */
+static void decim_init(Decimator *d, int factor, int fixed, int cap, Arena *a){
+  memset(d,0,sizeof(*d)); d->fixed=fixed;
+  while((1<<d->stages) < factor) d->stages++;
+  size_t mark=0;
+  for(int s=0;s<d->stages;s++){
+    int L=d->L[s]=decim_stage_taps(s,d->stages);
+    if(fixed){ d->hq[s]=ARENA_NEW(a,q15,L); d->histq[s]=ARENA_NEW(a,q15,L-1); }
+    else { d->h[s]=ARENA_NEW(a,double,L); d->hist[s]=ARENA_NEW(a,double,L-1); }
+    mark=arena_mark(a);
+    double *h=ARENA_NEW(a,double,L);                 // design scratch, released below
+    if(h){
+      fir_halfband(h,L);
+      if(fixed){ for(int i=0;i<L;i++) d->hq[s][i]=q15_from_double(h[i]); memset(d->histq[s],0,sizeof(q15)*(L-1)); }
+      else { memcpy(d->h[s],h,sizeof(double)*L); memset(d->hist[s],0,sizeof(double)*(L-1)); }
+    }
+    arena_release(a,mark);
+  }
+  if(!d->stages) return;
+  if(fixed) d->bufq=ARENA_NEW(a,q15,DEC_TAPS-1+cap);
+  else d->buf=ARENA_NEW(a,double,DEC_TAPS-1+cap);
+}
+
+/* In place: x[0..n) -> x[0..return). Taps are symmetric, so the window of inputs
+   i-H..i is dotted with h directly. */
+static int decim_run(Decimator *d, double *x, int n){
+  for(int s=0;s<d->stages;s++){
+    int H=d->L[s]-1; const double *h=d->h[s];
+    memcpy(d->buf, d->hist[s], sizeof(double)*H); memcpy(d->buf+H, x, sizeof(double)*n);
+    int m=0;
+    for(int i=d->phase[s]; i<n; i+=2){
+      const double *xp=d->buf+i; double acc=h[H/2]*xp[H/2];
+      for(int k=0;k<=H;k+=2) acc+=h[k]*xp[k];          // only even taps and the centre are non-zero
+      x[m++]=acc;
+    }
+    memcpy(d->hist[s], d->buf+n, sizeof(double)*H);
+    d->phase[s]=(d->phase[s]+n)&1; n=m;
+  }
+  return n;
+}
+
+static int decim_run_q15(Decimator *d, q15 *x, int n){
+  for(int s=0;s<d->stages;s++){
+    int L=d->L[s], H=L-1;
+    memcpy(d->bufq, d->histq[s], sizeof(q15)*H); memcpy(d->bufq+H, x, sizeof(q15)*n);
+    int m=0;
+    for(int i=d->phase[s]; i<n; i+=2){
+      int64_t acc=q15k->dot(d->bufq+i, d->hq[s], L);
+      x[m++]=sat16((int32_t)((acc + (1LL<<14)) >> 15));
+    }
+    memcpy(d->histq[s], d->bufq+n, sizeof(q15)*H);
+    d->phase[s]=(d->phase[s]+n)&1; n=m;
+  }
+  return n;
+}
+
+/* A whole capture in DEC_BLOCK pieces, so the block buffer stays small; outputs are
+   packed to the front of x. Same result as one decim_run*() call. */
+#define DEC_BLOCK 4096
+
+static int decim_apply(Decimator *d, void *x, int n){
+  int m=0;
+  for(int off=0; off<n; off+=DEC_BLOCK){
+    int c = n-off<DEC_BLOCK? n-off : DEC_BLOCK;
+    if(d->fixed){ q15 *p=(q15*)x; int k=decim_run_q15(d,p+off,c); memmove(p+m,p+off,sizeof(q15)*k); m+=k; }
+    else { double *p=(double*)x; int k=decim_run(d,p+off,c); memmove(p+m,p+off,sizeof(double)*k); m+=k; }
+  }
+  return m;
+}
+
+
+/* ---------------- Fast kurtogram (--auto-band) ----------------
+   Antoni's 1/3-binary filter-bank tree over the raw capture. Every node is split into two
+   half bands (complex quasi-analytic low/high-pass, decimation by 2) down to level L, and
+   the binary nodes of level k-1 are also split into thirds (decimation by 3) for level
+   k+0.6. Each branch is shifted back to baseband after decimation, so band order holds
+   down the tree and band i of a row with B bands is [i, i+1]*fs/(2B). The spectral
+   kurtosis of a node is that of its complex envelope, E|c|^4/E^2|c|^2 - 2 (real signal at
+   the root: -3). The walk is depth first with one buffer per level: a few short FIR
+   passes over the capture instead of one full pipeline run per candidate band. */
+#define KURT_TAPS       33    // prototype low-pass length, both splits
+#define KURT_MIN_LEN    256   // shortest node signal the tree goes down to
+#define KURT_PAR_MIN    8192  // branch outputs from which the FIR is split across threads
+
+// binary level k sits in row 2k-1, thirds level k+0.6 in row 2k
+static int kurt_rows(int L){ return L? 2*L : 1; }
+static int kurt_row_bands(int r){ return r==0? 1 : (r&1)? 1<<((r+1)/2) : 3<<(r/2-1); }
+static int kurt_len(int n, int r){ return n>=KURT_TAPS? (n-KURT_TAPS)/r+1 : 0; }
+
+/* Depth of the tree for an N-sample capture: the finest selectable band (or levels when
+   given) and no node shorter than KURT_MIN_LEN. */
+static int kurt_levels(const Config *cfg, const BearingGeom *g, int N){
+  double bw_min=2.0*search_top_all(cfg,g)*(1.0+DET_TOL_REL);
+  int L=0, n=N;
+  while(L<KURT_MAX_LEVELS && (cfg->kurt_levels? L<cfg->kurt_levels : cfg->fs/(4<<L)>=bw_min)){
+    n=kurt_len(n,2); if(n<KURT_MIN_LEN) break;
+    L++;
+  }
+  return L;
+}
+
+static void kurt_carve(Kurtogram *k, Arena *a, int L){
+  memset(k,0,sizeof(*k)); k->L=L; k->rows=kurt_rows(L);
+  for(int r=0;r<k->rows;r++){ k->bands[r]=kurt_row_bands(r); k->off[r]=k->nodes; k->nodes+=k->bands[r]; }
+  k->sk=ARENA_NEW(a,double,k->nodes);
+}
+
+typedef struct {
+  Kurtogram *k; cplx h[2][KURT_TAPS], g[3][KURT_TAPS];   // half-band and third-band branches
+  cplx **buf, *tmp;                   // node signal per binary level, thirds scratch
+  int threads;
+} KurtWalk;
+
+typedef struct { const cplx *x; const double *xr; const cplx *hm; int r, i; cplx *y; } KurtBranch;
+
+/* One branch: y[m] = (-1)^(i*m) * sum_j hm[j] x[r*m + KURT_TAPS-1 - j]. The sign brings
+   band i to baseband (up to a constant phase). x is complex, or real (xr) at the root. */
+static void kurt_branch_chunk(void *ctx, int lo, int hi, int tid){
+  (void)tid; const KurtBranch *k=(const KurtBranch*)ctx;
+  const cplx *x=k->x, *hm=k->hm; const double *xr=k->xr; int r=k->r, i=k->i; cplx *y=k->y;
+  for(int m=lo;m<hi;m++){
+    double re=0.0, im=0.0; int b=r*m+KURT_TAPS-1;
+    if(xr) for(int j=0;j<KURT_TAPS;j++){ double v=xr[b-j]; re+=hm[j].re*v; im+=hm[j].im*v; }
+    else for(int j=0;j<KURT_TAPS;j++){ cplx v=x[b-j]; re+=hm[j].re*v.re - hm[j].im*v.im; im+=hm[j].re*v.im + hm[j].im*v.re; }
+    if((i*m)&1){ re=-re; im=-im; }
+    y[m].re=re; y[m].im=im;
+  }
+}
+
+// only the top levels are long enough to be worth the threads
+static int kurt_branch(const cplx *x, const double *xr, int n, const cplx *hm, int r, int i, cplx *y, int threads){
+  KurtBranch k={x,xr,hm,r,i,y}; int ny=kurt_len(n,r);
+  par_for(ny>=KURT_PAR_MIN? threads : 1, ny, kurt_branch_chunk, &k);
+  return ny;
+}
+
+static double kurt_sk(const cplx *c, int n){
+  if(n<2) return 0.0;
+  double mr=0.0, mi=0.0; for(int i=0;i<n;i++){ mr+=c[i].re; mi+=c[i].im; } mr/=n; mi/=n;
+  double m2=0.0, m4=0.0;
+  for(int i=0;i<n;i++){ double p=(c[i].re-mr)*(c[i].re-mr) + (c[i].im-mi)*(c[i].im-mi); m2+=p; m4+=p*p; }
+  m2/=n; m4/=n;
+  return m2>0.0? m4/(m2*m2)-2.0 : 0.0;
+}
+
+static void kurt_node(KurtWalk *w, const cplx *x, const double *xr, int n, int lev, int idx){
+  Kurtogram *k=w->k;
+  if(lev+1<k->L){
+    int r=2*(lev+1);
+    for(int t=0;t<3;t++){ int ny=kurt_branch(x,xr,n,w->g[t],3,t,w->tmp,w->threads); k->sk[k->off[r]+3*idx+t]=kurt_sk(w->tmp,ny); }
+  }
+  if(lev<k->L){
+    int r=2*lev+1; cplx *y=w->buf[lev+1];
+    for(int b=0;b<2;b++){
+      int ny=kurt_branch(x,xr,n,w->h[b],2,b,y,w->threads); k->sk[k->off[r]+2*idx+b]=kurt_sk(y,ny);
+      kurt_node(w,y,NULL,ny,lev+1,2*idx+b);
+    }
+  }
+}
+
+/* Fills k->sk from the capture (acc, or the int16 Q15 mapping xq through xr) and selects
+   the widest-enough node with the highest kurtosis. buf[1..L] hold the binary levels. */
+static void kurtogram_run(Kurtogram *k, const Config *cfg, const BearingGeom *g, int N,
+                          const double *acc, const q15 *xq, double *xr, cplx **buf, cplx *tmp){
+  KurtWalk w; w.k=k; w.buf=buf; w.tmp=tmp; w.threads=cfg->threads;
+  k->fs=cfg->fs; k->bw_min=2.0*search_top_all(cfg,g)*(1.0+DET_TOL_REL);
+  double h[KURT_TAPS];
+  fir_bandpass(h,KURT_TAPS,1.0,0.0,1.0/8);             // +-fs/8, modulated to the two half bands
+  for(int b=0;b<2;b++) for(int j=0;j<KURT_TAPS;j++){ double ph=M_PI*(2*b+1)*j/4.0; w.h[b][j].re=h[j]*cos(ph); w.h[b][j].im=h[j]*sin(ph); }
+  fir_bandpass(h,KURT_TAPS,1.0,0.0,1.0/12);            // +-fs/12, to the three thirds
+  for(int t=0;t<3;t++) for(int j=0;j<KURT_TAPS;j++){ double ph=M_PI*(2*t+1)*j/6.0; w.g[t][j].re=h[j]*cos(ph); w.g[t][j].im=h[j]*sin(ph); }
+  if(!acc){ for(int i=0;i<N;i++) xr[i]=q15_to_double(xq[i]); acc=xr; }
+  double m=0.0, m2=0.0, m4=0.0;
+  for(int i=0;i<N;i++) m+=acc[i]; m/=N;
+  for(int i=0;i<N;i++){ double p=(acc[i]-m)*(acc[i]-m); m2+=p; m4+=p*p; }
+  m2/=N; m4/=N; k->sk[0] = m2>0.0? m4/(m2*m2)-3.0 : 0.0;
+  kurt_node(&w,NULL,acc,N,0,0);
+  k->row=0; k->band=0; k->best=-INFINITY;
+  for(int r=0;r<k->rows;r++){
+    double bw=k->fs/(2.0*k->bands[r]); if(bw<k->bw_min && r) continue;
+    for(int i=0;i<k->bands[r];i++) if(k->sk[k->off[r]+i]>k->best){ k->best=k->sk[k->off[r]+i]; k->row=r; k->band=i; }
+  }
+  double bw=k->fs/(2.0*k->bands[k->row]); k->lo=k->band*bw; k->hi=(k->band+1)*bw;
+}
+
+/* ---------------- Shared setup cache ----------------
+   FFT plans, Hann windows and FIR taps keyed by their parameters. Built on first use
+   and then shared read-only by every capture and worker thread in the process. */
+enum { CE_PLAN, CE_HANN, CE_HANN_Q15, CE_TW_Q15, CE_REV_Q15, CE_FIR, CE_FIR_Q15 };
+
+typedef struct CacheEntry {
+  int kind, n; double fs, lo, hi;
+  void *obj;
+  int owned;                       // 0 for pregenerated tables (static storage)
+  size_t bytes;
+  struct CacheEntry *next;
+} CacheEntry;
+
+struct PlanCache { pthread_mutex_t lock; CacheEntry *head; };
+
+static void cache_init(PlanCache *pc){ pthread_mutex_init(&pc->lock,NULL); pc->head=NULL; }
+
+static void *cache_build(int kind, int n, double fs, double lo, double hi){
+  switch(kind){
+    case CE_PLAN: return fft_plan_create(n);
+    case CE_HANN: { double *w=(double*)malloc(sizeof(double)*n); hann_window(w,n); return w; }
+    case CE_HANN_Q15: { q15 *w=(q15*)malloc(sizeof(q15)*n); q15_hann_fill(w,n); return w; }
+    case CE_TW_Q15: { q15c *w=(q15c*)malloc(sizeof(q15c)*(n/2>1? n/2 : 1)); q15_twiddle_fill(w,n); return w; }
+    case CE_REV_Q15: { int f[FFT_MAX_FACTORS], nf=fft_factor(n,0,f); int *r=(int*)malloc(sizeof(int)*n); fft_digit_rev(r,n,f,nf); return r; }
+    case CE_FIR: { double *h=(double*)malloc(sizeof(double)*n); fir_bandpass(h,n,fs,lo,hi); return h; }
+    case CE_FIR_Q15: {
+      double *h=(double*)malloc(sizeof(double)*n); fir_bandpass(h,n,fs,lo,hi);
+      q15 *hq=(q15*)malloc(sizeof(q15)*n); for(int i=0;i<n;i++) hq[i]=q15_from_double(h[i]);
+      free(h); return hq; }
+  }
+  return NULL;
+}
+
+static size_t cache_obj_bytes(int kind, int n){
+  switch(kind){
+    case CE_PLAN: return sizeof(FftPlan) + sizeof(int)*(size_t)n + sizeof(cplx)*(size_t)(n>1? n/2 : 1);
+    case CE_HANN: case CE_FIR: return sizeof(double)*(size_t)n;
+    case CE_HANN_Q15: case CE_FIR_Q15: return sizeof(q15)*(size_t)n;
+    case CE_TW_Q15: return sizeof(q15c)*(size_t)(n/2>1? n/2 : 1);
+    case CE_REV_Q15: return sizeof(int)*(size_t)n;
+  }
+  return 0;
+}
+
+static const void *cache_get(PlanCache *pc, int kind, int n, double fs, double lo, double hi){
+  pthread_mutex_lock(&pc->lock);
+  CacheEntry *e=pc->head;
+  for(; e; e=e->next) if(e->kind==kind && e->n==n && e->fs==fs && e->lo==lo && e->hi==hi) break;
+  if(!e){
+    e=(CacheEntry*)malloc(sizeof(CacheEntry));
+    e->kind=kind; e->n=n; e->fs=fs; e->lo=lo; e->hi=hi; e->owned=0;
+    e->obj = kind==CE_HANN_Q15? (void*)q15_table_hann(n) : kind==CE_TW_Q15? (void*)q15_table_twiddles(n) : NULL;
+    if(!e->obj){ e->obj=cache_build(kind,n,fs,lo,hi); e->owned=1; }
+    e->bytes=cache_obj_bytes(kind,n);
+    e->next=pc->head; pc->head=e;
+  }
+  pthread_mutex_unlock(&pc->lock);
+  return e->obj;
+}
+
+static const FftPlan *cache_plan(PlanCache *pc, int N){ return (const FftPlan*)cache_get(pc,CE_PLAN,N,0,0,0); }
+static const double *cache_hann(PlanCache *pc, int N){ return (const double*)cache_get(pc,CE_HANN,N,0,0,0); }
+static const q15 *cache_hann_q15(PlanCache *pc, int N){ return (const q15*)cache_get(pc,CE_HANN_Q15,N,0,0,0); }
+static const q15c *cache_tw_q15(PlanCache *pc, int N){ return (const q15c*)cache_get(pc,CE_TW_Q15,N,0,0,0); }
+static const double *cache_fir(PlanCache *pc, const Config *c){ return (const double*)cache_get(pc,CE_FIR,c->taps,c->fs,c->band_lo,c->band_hi); }
+static const q15 *cache_fir_q15(PlanCache *pc, const Config *c){ return (const q15*)cache_get(pc,CE_FIR_Q15,c->taps,c->fs,c->band_lo,c->band_hi); }
+
+static void q15_fft_init(Q15Fft *q, PlanCache *pc, int N){
+  q->N=N; q->nf=fft_factor(N,0,q->f);
+  q->tw=cache_tw_q15(pc,N); q->rev=(const int*)cache_get(pc,CE_REV_Q15,N,0,0,0);
+}
+
+/* Bytes held by the cache: heap-built entries (owned=1) or pregenerated tables (owned=0). */
+static size_t cache_bytes(PlanCache *pc, int owned){
+  size_t b=0; pthread_mutex_lock(&pc->lock);
+  for(const CacheEntry *e=pc->head; e; e=e->next) if(e->owned==owned) b+=e->bytes;
+  pthread_mutex_unlock(&pc->lock);
+  return b;
+}
+
+static void cache_free(PlanCache *pc){
+  for(CacheEntry *e=pc->head, *nx; e; e=nx){
+    nx=e->next;
+    if(e->kind==CE_PLAN) fft_plan_destroy((FftPlan*)e->obj); else if(e->owned) free(e->obj);
+    free(e);
+  }
+  pc->head=NULL; pthread_mutex_destroy(&pc->lock);
+}
+
+/* ---------------- Time-domain gate (--gate) ----------------
+   RMS, peak, crest factor and kurtosis of the raw capture in one pass (integer sums on the
+   int16 Q15 mapping). The spectral path runs only when a feature crosses its threshold,
+   leaves the baseline by more than dev standard deviations, or on every K-th window; a
+   gated record carries the features and predictions only. The baseline (Welford mean/M2
+   per feature over healthy windows) and the window count live in the --gate-state file,
+   one per asset. A batch reads it once and folds its windows in manifest order at the end,
+   so records do not depend on which worker ran first. */
+#define GATE_WARMUP    8      // healthy windows before baseline deviations count
+#define GATE_REL_FLOOR 0.05   // smallest deviation scale, fraction of the baseline mean
+
+const char *const rfd_gate_feature[GATE_NF]={ "rms", "peak", "crest", "kurtosis" };
+
+/* AC-coupled features: RMS and kurtosis about the mean, peak as the largest excursion
+   from it. The Q15 path keeps every power exact: v^2 in full Q30, v^3 and v^4 summed in
+   64-bit over GATE_QBLOCK samples (|v|^4 < 2^60) and only then folded into doubles, so
+   low-level windows keep their kurtosis. */
+#define GATE_QBLOCK 8
+static void gate_features(const double *x, const q15 *xq, int N, double f[GATE_NF]){
+  double s1=0.0, s2=0.0, s3=0.0, s4=0.0, hi, lo;
+  if(xq){
+    int64_t i1=0, i2=0; int32_t mx=-32768, mn=32767;
+    for(int b=0;b<N;b+=GATE_QBLOCK){
+      int e=b+GATE_QBLOCK<N? b+GATE_QBLOCK : N;
+      int64_t i3=0; uint64_t i4=0;
+      for(int i=b;i<e;i++){
+        int32_t v=xq[i]; int64_t v2=(int64_t)v*v;   // Q30
+        i1+=v; i2+=v2; i3+=v2*v; i4+=(uint64_t)(v2*v2);
+        if(v>mx) mx=v; if(v<mn) mn=v;
+      }
+      s3+=(double)i3; s4+=(double)i4;
+    }
+    s1=i1/32768.0; s2=i2/1073741824.0; s3/=35184372088832.0; s4/=1152921504606846976.0; hi=mx/32768.0; lo=mn/32768.0;   // Q15, Q30, Q45, Q60
+  } else {
+    hi=-INFINITY; lo=INFINITY;
+    for(int i=0;i<N;i++){ double v=x[i], v2=v*v; s1+=v; s2+=v2; s3+=v2*v; s4+=v2*v2; if(v>hi) hi=v; if(v<lo) lo=v; }
+  }
+  double m=s1/N, e2=s2/N, e3=s3/N, e4=s4/N;
+  double var=e2-m*m, m4=e4 - 4*m*e3 + 6*m*m*e2 - 3*m*m*m*m;
+  f[0]=var>0.0? sqrt(var) : 0.0; f[1]=fmax(hi-m, m-lo);
+  f[2]=f[0]>0.0? f[1]/f[0] : 0.0; f[3]=var>0.0? m4/(var*var) : 0.0;
+}
+
+static void gate_decide(const Config *cfg, const GateBase *b, GateResult *r){
+  r->run_full=1; r->fault=0; r->baseline_n=b? b->n : 0;
+  for(int k=0;k<GATE_NF;k++) if(cfg->gate_th[k]>0.0 && r->f[k]>cfg->gate_th[k]){
+    snprintf(r->reason,sizeof(r->reason),"%s above %.3g", rfd_gate_feature[k], cfg->gate_th[k]); return;
+  }
+  if(b && b->n>=GATE_WARMUP) for(int k=0;k<GATE_NF;k++){
+    double sd=fmax(sqrt(b->m2[k]/(b->n-1)), GATE_REL_FLOOR*fabs(b->mean[k])), z=fabs(r->f[k]-b->mean[k])/sd;
+    if(z>cfg->gate_dev){ snprintf(r->reason,sizeof(r->reason),"%s off baseline (%.1f sd)", rfd_gate_feature[k], z); return; }
+  }
+  if(cfg->gate_every>0 && r->window%cfg->gate_every==cfg->gate_every-1){ strcpy(r->reason,"forced check"); return; }
+  r->run_full=0; strcpy(r->reason,"within thresholds and baseline");
+}
+
+/* Counts the window; only healthy ones move the baseline. */
+void rfd_gate_fold(GateBase *b, const GateResult *r){
+  b->windows++;
+  if(r->fault) return;
+  b->n++;
+  for(int k=0;k<GATE_NF;k++){ double d=r->f[k]-b->mean[k]; b->mean[k]+=d/b->n; b->m2[k]+=d*(r->f[k]-b->mean[k]); }
+}
+
+/* A missing state file is a fresh baseline. */
+int rfd_gate_load(const char *path, GateBase *b){
+  memset(b,0,sizeof(*b));
+  if(!path[0]) return 0;
+  FILE *f=fopen(path,"rb"); if(!f) return 0;
+  int ok = fscanf(f,"rotor_fd-gate 1 windows %ld n %ld",&b->windows,&b->n)==2;
+  char name[32]; double mean, m2;
+  while(ok && fscanf(f," %31s %lf %lf",name,&mean,&m2)==3)
+    for(int k=0;k<GATE_NF;k++) if(strcmp(name,rfd_gate_feature[k])==0){ b->mean[k]=mean; b->m2[k]=m2; }
+  fclose(f);
+  if(!ok){ fprintf(stderr,"%s is not a gate state file\n", path); memset(b,0,sizeof(*b)); return -1; }
+  return 0;
+}
+
+int rfd_gate_save(const char *path, const GateBase *b){
+  if(!path[0]) return 0;
+  FILE *f=fopen(path,"wb"); if(!f){ fprintf(stderr,"Cannot write %s\n", path); return -1; }
+  fprintf(f,"rotor_fd-gate 1\nwindows %ld n %ld\n", b->windows, b->n);
+  for(int k=0;k<GATE_NF;k++) fprintf(f,"%s %.17g %.17g\n", rfd_gate_feature[k], b->mean[k], b->m2[k]);
+  return fclose(f)==0? 0 : -1;
+}
+
+/* --profile: wall-clock seconds and cycles per stage since the previous lap, plus the
+   heap high-water mark. On the host the heap is sampled at each lap (exact on the MCU,
+   where _sbrk never shrinks). */
+const char *const rfd_perf_stage[PF_STAGES]={ "load", "gate", "setup", "kurtogram", "fir", "envelope", "decimate", "welch", "detect", "order", "json" };
+
+static void perf_start(Perf *p){ memset(p,0,sizeof(*p)); p->t=perf_seconds(); p->c=perf_cycles(); p->heap_peak=perf_heap_bytes(); }
+
+static void perf_lap(Perf *p, int k){
+  if(!p) return;
+  double t=perf_seconds(); uint64_t c=perf_cycles(); size_t h=perf_heap_bytes();
+  p->s[k]+=t-p->t; p->cyc[k]+=c-p->c; p->t=t; p->c=c; if(h>p->heap_peak) p->heap_peak=h;
+}
+
+void rfd_perf_lap(Perf *p, int k){ perf_lap(p,k); }
+
+/* Starts the next record's accounting (stream mode); the lap mark carries over. */
+static void perf_clear(Perf *p){ memset(p->s,0,sizeof(p->s)); memset(p->cyc,0,sizeof(p->cyc)); p->signal_s=0.0; }
+
+/* ---------------- Streaming mode ----------------
+   Samples arrive as CSV lines (acc[,tach]) or a binary capture on stdin or a FIFO.
+   State carried between blocks: FIR history (L-1 samples), envelope overlap (2*G
+   samples) and one Welch segment, so memory is bounded by nperseg regardless of
+   capture length. */
+#define STREAM_BLOCK 4096
+
+typedef struct {
+  const double *h; int L; const FftPlan *plan;   // plan NULL -> direct form
+  double *buf, *tmp;                             // [L-1 history | block]
+  FirScratch sc;
+} FirStream;
+
+/* Buffers come from the stream arena (see run_stream); NULL pointers on a sizing pass. */
+static void fir_stream_init(FirStream *s, const double *h, int L, const FftPlan *plan, Arena *a){
+  s->h=h; s->L=L; s->plan=plan;
+  s->buf=ARENA_NEW(a,double,L-1+STREAM_BLOCK); if(s->buf) memset(s->buf,0,sizeof(double)*(L-1+STREAM_BLOCK));
+  s->tmp=plan? ARENA_NEW(a,double,L-1+STREAM_BLOCK) : NULL;
+  memset(&s->sc,0,sizeof(s->sc)); if(plan) fir_scratch_carve(&s->sc,a,plan->N,1);
+}
+
+static void fir_stream_process(FirStream *s, const double *x, int n, double *y){
+  int L=s->L, H=L-1;
+  memcpy(s->buf+H, x, sizeof(double)*n);
+  if(s->plan){
+    conv_fir_fft(s->plan, s->buf, H+n, s->h, L, s->tmp, 1, &s->sc);
+    memcpy(y, s->tmp+H, sizeof(double)*n);
+  } else {
+    for(int i=0;i<n;i++){ const double *xp=s->buf+H+i; double acc=0.0; for(int k=0;k<L;k++) acc+=s->h[k]*xp[-k]; y[i]=acc; }
+  }
+  memmove(s->buf, s->buf+n, sizeof(double)*H);
+}
+
+/* Envelope over blocks of E samples advancing by E-2G; the G samples at each block
+   edge, where the FFT Hilbert transform wraps around, are discarded. */
+typedef struct {
+  const FftPlan *plan; int E, G;
+  double *buf, *env, *hx; cplx *X; int fill, first;
+} EnvStream;
+
+static void env_stream_init(EnvStream *s, const FftPlan *plan, Arena *a){
+  s->plan=plan; s->E=plan->N; s->G=s->E/8; s->fill=0; s->first=1;
+  s->buf=ARENA_NEW(a,double,s->E); s->env=ARENA_NEW(a,double,s->E);
+  s->hx=ARENA_NEW(a,double,s->E); s->X=ARENA_NEW(a,cplx,s->E/2+1);
+}
+
+/* Push filtered samples; returns the number of envelope samples written to out
+   (out must hold n + E samples). */
+static int env_stream_push(EnvStream *s, const double *y, int n, double *out, int flush){
+  int E=s->E, G=s->G, produced=0;
+  while(n>0 || flush){
+    int take=E - s->fill; if(take>n) take=n;
+    memcpy(s->buf+s->fill, y, sizeof(double)*take); s->fill+=take; y+=take; n-=take;
+    if(s->fill<E){
+      if(!flush || s->fill<=(s->first? 0 : G)) break;
+      for(int i=s->fill;i<E;i++) s->buf[i]=0.0;
+    }
+    int valid=s->fill;
+    envelope_fft_float(s->plan, s->buf, E, s->env, 1, s->X, s->hx);
+    int lo = s->first? 0 : G, hi = (valid<E)? valid : E-G;
+    memcpy(out+produced, s->env+lo, sizeof(double)*(hi-lo)); produced+=hi-lo;
+    if(valid<E) break;
+    memmove(s->buf, s->buf+E-2*G, sizeof(double)*2*G); s->fill=2*G; s->first=0;
+  }
+  return produced;
+}
+
+/* Welch accumulator: one 50%-overlap segment buffer and a running periodogram sum. */
+typedef struct {
+  const FftPlan *plan; int nperseg, step, fill;
+  double *win, win_pow, *seg, *xw, *acc;
+  cplx *X;
+  long segments, in_record;
+} WelchStream;
+
+static void welch_stream_init(WelchStream *w, const FftPlan *plan, Arena *a){
+  int n=plan->N; w->plan=plan; w->nperseg=n; w->step=n/2; w->fill=0; w->segments=0; w->in_record=0;
+  w->win=ARENA_NEW(a,double,n); w->seg=ARENA_NEW(a,double,n); w->xw=ARENA_NEW(a,double,n);
+  w->acc=ARENA_NEW(a,double,n/2+1); w->X=ARENA_NEW(a,cplx,n/2+1); w->win_pow=0.0;
+  if(!w->win) return;
+  hann_window(w->win,n); for(int i=0;i<n;i++) w->win_pow+=w->win[i]*w->win[i];
+  memset(w->acc,0,sizeof(double)*(n/2+1));
+}
+
+/* Consume up to the next segment boundary; returns samples consumed and sets *done
+   when a segment was folded into the accumulator. */
+static int welch_stream_push(WelchStream *w, const double *x, int n, int *done){
+  int take=w->nperseg - w->fill; if(take>n) take=n;
+  memcpy(w->seg+w->fill, x, sizeof(double)*take); w->fill+=take; *done=0;
+  if(w->fill==w->nperseg){
+    for(int i=0;i<w->nperseg;i++) w->xw[i]=w->seg[i]*w->win[i];
+    rfft_exec(w->plan, w->xw, w->X, 1);
+    for(int k=0;k<=w->nperseg/2;k++){ double a=w->X[k].re, b=w->X[k].im; w->acc[k]+=a*a+b*b; }
+    memmove(w->seg, w->seg+w->step, sizeof(double)*(w->nperseg-w->step)); w->fill=w->nperseg-w->step;
+    w->segments++; w->in_record++; *done=1;
+  }
+  return take;
+}
+
+/* Scale the accumulated periodograms exactly as welch_psd_float() and reset. */
+static void welch_stream_take(WelchStream *w, double fs, double *freqs, double *Pxx){
+  int n=w->nperseg;
+  for(int k=0;k<=n/2;k++){ freqs[k]=(fs*k)/n; Pxx[k]=w->acc[k]; Pxx[k]/=w->in_record; Pxx[k]/=w->win_pow; Pxx[k]*=2.0; Pxx[k]/=fs; w->acc[k]=0.0; }
+  Pxx[0]*=0.5; Pxx[n/2]*=0.5;
+  w->in_record=0;
+}
+
+static void stream_emit(FILE *out, const Config *cfg, const BearingGeom *g, WelchStream *ws,
+                        double *f_hz, double *P_hz, PeakTable *pt, BearingSet *bs, double t_end_s, const Q15Mon *mon, Perf *pf){
+  StreamInfo st={ ws->segments, ws->in_record, t_end_s };
+  welch_stream_take(ws, cfg->fs/cfg->decim_used, f_hz, P_hz);
+  perf_lap(pf,PF_WELCH);
+  Detections det; peak_table_build(pt,f_hz,P_hz,ws->nperseg/2+1); detect_hz(g,pt,&det);
+  if(bs->e) detect_set(cfg,g,pt,bs);
+  perf_lap(pf,PF_DETECT);
+  RfdResult r={ .cfg=cfg, .geom=g, .det=det, .bearings=bs->e? bs : NULL, .q15=mon, .stream=&st, .perf=pf, .f_hz=f_hz, .psd=P_hz, .bins=ws->nperseg/2+1 };
+  rfd_write_json(out,&r);
+  if(pf) perf_clear(pf);
+  fprintf(stderr,"segment %ld (t=%.2fs): fault=%s, conf=%.2f\n", st.segment, t_end_s, det.fault, det.conf);
+}
+
+/* Every buffer the stream loop touches, carved from one block sized by a first pass
+   over the same layout; the loop itself never allocates. */
+typedef struct {
+  FirStream fir; EnvStream env_s; WelchStream welch; Decimator dec; PeakTable peaks; BearingSet bearings;
+  double *h, *x, *y, *env, *f_hz, *P_hz;
+} StreamState;
+
+static void stream_layout(StreamState *st, Arena *a, const Config *cfg, const FftPlan *fir_plan,
+                          const FftPlan *env_plan, const FftPlan *seg_plan, int D){
+  int taps=cfg->taps, E=env_plan->N, K=seg_plan->N/2+1;
+  st->h=ARENA_NEW(a,double,taps); if(st->h) fir_bandpass(st->h,taps,cfg->fs,cfg->band_lo,cfg->band_hi);
+  st->x=ARENA_NEW(a,double,STREAM_BLOCK); st->y=ARENA_NEW(a,double,STREAM_BLOCK);
+  st->env=ARENA_NEW(a,double,STREAM_BLOCK+E);
+  st->f_hz=ARENA_NEW(a,double,K); st->P_hz=ARENA_NEW(a,double,K); peak_table_carve(&st->peaks,a,K);
+  int nev=bearing_set_size(cfg); st->bearings.e = nev? ARENA_NEW(a,BearingEval,nev) : NULL;
+  fir_stream_init(&st->fir, st->h, taps, fir_plan, a);
+  env_stream_init(&st->env_s, env_plan, a);
+  welch_stream_init(&st->welch, seg_plan, a);
+  decim_init(&st->dec, D, 0, STREAM_BLOCK+E, a);
+}
+
+int rfd_run_stream(const Config *cfg, const BearingGeom *g, FILE *in, FILE *out){
+  if(cfg->fixed){ fprintf(stderr,"--stream supports the float path only\n"); return 1; }
+  if(!fft_len_ok(cfg->nperseg)){ fprintf(stderr,"--stream needs an even 2/3/5-smooth --nperseg\n"); return 1; }
+  SampleReader rd;
+  if(reader_open(&rd,in)!=0){ fprintf(stderr,"Bad capture header on stream input\n"); reader_close(&rd); return 1; }
+  Config run=*cfg; if(rd.binary){ run.fs=rd.hdr.fs_hz; run.pod_id=(long)rd.hdr.pod_id; }
+  cfg=&run;
+
+  Perf perf, *pf=NULL;
+  if(cfg->profile){ perf_start(&perf); pf=&perf; }
+  int taps=cfg->taps, nperseg=cfg->nperseg, E=nperseg<1024? 1024 : nperseg;
+  int D=decim_factor(cfg,g,cfg->fs,nperseg), nseg=nperseg/D; run.decim_used=D;
+  FftPlan *fir_plan = taps>=FIR_FFT_MIN_TAPS ? fft_plan_create(ols_fft_size(taps)) : NULL;
+  FftPlan *seg_plan = fft_plan_create(nseg);
+  FftPlan *env_plan = (E==nseg)? seg_plan : fft_plan_create(E);
+  StreamState st; Arena ar; arena_sizing(&ar);
+  stream_layout(&st,&ar,cfg,fir_plan,env_plan,seg_plan,D);
+  size_t bytes=ar.peak; void *block=arena_block(bytes);
+  arena_attach(&ar,block,bytes); stream_layout(&st,&ar,cfg,fir_plan,env_plan,seg_plan,D);
+  FirStream fs_=st.fir; EnvStream es=st.env_s; WelchStream ws=st.welch; Decimator dc=st.dec;
+  double *x=st.x, *y=st.y, *env=st.env, *f_hz=st.f_hz, *P_hz=st.P_hz;
+  Q15Mon mon={0,0.0}; long consumed=0; int eof=0;
+  const Q15Mon *mon_ptr = cfg->q15simulate? &mon : NULL;
+  if(pf){ perf.workspace=bytes; perf_lap(pf,PF_SETUP); }   // the first record carries the setup, each covers the blocks since the last
+
+  while(!eof){
+    int n=reader_read(&rd, x, NULL, STREAM_BLOCK);
+    if(n<STREAM_BLOCK) eof=1;
+    if(cfg->q15simulate){ for(int i=0;i<n;i++){ double v=x[i]; if(fabs(v)>mon.peak_abs) mon.peak_abs=fabs(v); if(v<=-1.0 || v>=1.0) mon.overflows++; } }
+    consumed+=n; if(pf){ perf.signal_s+=n/cfg->fs; perf_lap(pf,PF_LOAD); }
+    fir_stream_process(&fs_, x, n, y); perf_lap(pf,PF_FIR);
+    int m=env_stream_push(&es, y, n, env, eof); perf_lap(pf,PF_ENV);
+    m=decim_run(&dc, env, m); perf_lap(pf,PF_DECIM);
+    for(int off=0; off<m; ){
+      int done; off+=welch_stream_push(&ws, env+off, m-off, &done);
+      if(done && (ws.segments==1 || ws.in_record>=cfg->emit_every))
+        stream_emit(out, cfg, g, &ws, f_hz, P_hz, &st.peaks, &st.bearings, consumed/cfg->fs, mon_ptr, pf);
+    }
+    perf_lap(pf,PF_WELCH);
+    if(eof && ws.in_record>0) stream_emit(out, cfg, g, &ws, f_hz, P_hz, &st.peaks, &st.bearings, consumed/cfg->fs, mon_ptr, pf);
+  }
+  if(ws.segments==0) fprintf(stderr,"stream ended before one Welch segment (%d samples)\n", nperseg);
+
+  if(env_plan!=seg_plan) fft_plan_destroy(env_plan); fft_plan_destroy(seg_plan); fft_plan_destroy(fir_plan);
+  free(block);
+  reader_close(&rd);
+  return 0;
+}
+
+/* ---------------- Capture workspace ----------------
+   All DSP buffers of one capture come from a single block. ws_layout() runs twice: on a
+   sizing arena to get the exact byte count, then on the block to carve the pointers.
+   Stage scratch (kurtogram, FIR, envelope, Welch, peak table, order tracking) is released between
+   stages, so the block holds the persistent signal buffers plus the largest stage. Plans, windows and taps are
+   setup objects in the PlanCache and are not part of it. */
+typedef struct {
+  int N, Np, nperseg, D, nd, Kd, taps, T, fixed, fir_M, nev;
+  int ord_M, ord_n, ord_K; long ord_cap;   // order tracking (ord_M 0 = off): samples/rev, Welch segment, bins, resampled capacity
+  int kurt_L;                              // --auto-band kurtogram levels (-1 = off)
+  int patch_t, patch_b, patch_segs;        // --export-patch frames x bands (0 = off), Welch segment rows kept
+} WsDims;
+
+typedef struct {
+  double *f_hz, *P_hz, *y;          // float: y is the filtered signal, then its envelope
+  q15 *x_q, *y_q; q15c *z_q;        // fixed: input, filtered then envelope, analytic signal
+  FirScratch fir; q15 *hr;          // FIR stage
+  cplx *X; double *hx; q15c *w;     // envelope stage
+  WelchScratch welch;               // Welch stage
+  PeakTable peaks;                  // detection
+  BearingSet bearings;              // --geom list / --rpm-sweep results (e NULL if unused)
+  double *ord_x, *f_ord, *P_ord; q15 *ord_xq;   // order tracking: equal-angle envelope, order spectrum
+  WelchScratch ord_welch; PeakTable ord_peaks;
+  Kurtogram kurt; cplx *kurt_buf[KURT_MAX_LEVELS+1], *kurt_tmp; double *kurt_x;   // --auto-band, before the FIR
+  Decimator dec;
+  float *patch; int *patch_bk; double *patch_seg;   // --export-patch: output, band bins, per-segment band energies
+} WsLayout;
+
+typedef struct { void *block; size_t cap; } Workspace;   // grows only when a capture needs more
+
+typedef struct {
+  const double *h, *hann; const q15 *h_q, *hann_q;
+  const FftPlan *fir_plan, *env_plan, *seg_plan; Q15Fft fq_env, fq_seg;
+  const FftPlan *ord_plan; const double *ord_hann; const q15 *ord_hann_q; Q15Fft fq_ord;   // order tracking
+} WsTables;
+
+/* Order tracking sizes: M samples/rev puts the highest searched order (over all bearings)
+   and its noise ring inside DEC_PASS of the order Nyquist; the Welch segment spans a
+   power-of-two number of revolutions close to the Hz segment's span at nominal speed, so
+   the resolution in orders matches. Resampled capacity allows up to twice nominal speed. */
+static void order_dims(WsDims *d, const Config *cfg, const BearingGeom *g){
+  d->ord_M=d->ord_n=d->ord_K=0; d->ord_cap=0;
+  if(!cfg->enable_order) return;
+  double fr=fr_hz(g), revs_total=d->N*fr/cfg->fs, span=d->nperseg*fr/cfg->fs;
+  int revs=ORD_MIN_REVS; while(revs*2<=span && revs*2<=revs_total) revs*=2;
+  if(revs>revs_total) return;                   // too short for one segment
+  double top=search_top_hz(g)/fr;
+  for(int b=0;b<cfg->nmore;b++) top=fmax(top, search_top_hz(&cfg->more[b])/fr_hz(&cfg->more[b]));
+  top = top*(1.0+DET_TOL_REL) + (double)DET_RING_BINS/revs;
+  int M=fft_len_up((int)ceil(top/DEC_PASS));
+  d->ord_M=M; d->ord_n=M*revs; d->ord_K=d->ord_n/2+1; d->ord_cap=(long)(2.0*revs_total*M)+d->ord_n;
+}
+
+/* Capture dimensions: N samples zero-padded to the next 2/3/5-smooth length Np for the
+   one-shot envelope FFT, Welch on nd = nperseg/D points after decimation, nev bearing
+   evaluations (0 for a single geometry). */
+static void ws_dims(WsDims *d, const Config *cfg, const BearingGeom *g, int N){
+  d->N=N; d->Np=fft_len_up(N); d->taps=cfg->taps; d->T=cfg->threads; d->fixed=cfg->fixed;
+  int n=cfg->nperseg; if(n>d->Np){ n=1; while(n*2<=d->Np) n*=2; }
+  d->nperseg=n; d->D=decim_factor(cfg,g,cfg->fs,n); d->nd=n/d->D; d->Kd=d->nd/2+1;
+  d->fir_M = (!d->fixed && d->taps>=FIR_FFT_MIN_TAPS)? ols_fft_size(d->taps) : 0;
+  d->nev=bearing_set_size(cfg);
+  order_dims(d,cfg,g);
+  d->kurt_L = cfg->auto_band? kurt_levels(cfg,g,N) : -1;
+  d->patch_t=d->patch_b=d->patch_segs=0;
+  if(cfg->patch_t>0 && cfg->patch_b>0){ d->patch_t=cfg->patch_t; d->patch_b=cfg->patch_b; d->patch_segs=2*(d->Np/d->D+1)/d->nd+1; }
+}
+
+static void ws_layout(WsLayout *L, Arena *a, const WsDims *d){
+  memset(L,0,sizeof(*L));
+  L->f_hz=ARENA_NEW(a,double,d->Kd); L->P_hz=ARENA_NEW(a,double,d->Kd);
+  L->bearings.e = d->nev? ARENA_NEW(a,BearingEval,d->nev) : NULL;
+  if(d->fixed){
+    L->y_q=ARENA_NEW(a,q15,d->Np); L->z_q=ARENA_NEW(a,q15c,d->Np);
+    L->x_q=(q15*)L->z_q;            // converted input is dead once the FIR has run
+  } else L->y=ARENA_NEW(a,double,d->Np);
+  decim_init(&L->dec,d->D,d->fixed,DEC_BLOCK,a);
+  if(d->kurt_L>=0) kurt_carve(&L->kurt,a,d->kurt_L);
+  if(d->patch_t){ L->patch=ARENA_NEW(a,float,(size_t)d->patch_t*d->patch_b); L->patch_bk=ARENA_NEW(a,int,2*d->patch_b); }
+  size_t mark=arena_mark(a);
+  if(d->kurt_L>=0){                 // one node signal per binary level, the thirds of one node
+    for(int k=1,n=d->N;k<=d->kurt_L;k++){ n=kurt_len(n,2); L->kurt_buf[k]=ARENA_NEW(a,cplx,n); }
+    L->kurt_tmp=ARENA_NEW(a,cplx,kurt_len(d->N,3));
+    if(d->fixed) L->kurt_x=ARENA_NEW(a,double,d->N);
+    arena_release(a,mark);
+  }
+  if(d->fixed) L->hr=ARENA_NEW(a,q15,d->taps);
+  else if(d->fir_M) fir_scratch_carve(&L->fir,a,d->fir_M,d->T);
+  arena_release(a,mark);
+  if(d->fixed) L->w=ARENA_NEW(a,q15c,d->Np);
+  else { L->X=ARENA_NEW(a,cplx,d->Np/2+1); L->hx=ARENA_NEW(a,double,d->Np); }
+  arena_release(a,mark);
+  welch_scratch_carve(&L->welch,a,d->nd,d->T,d->fixed);
+  if(d->patch_t) L->patch_seg=ARENA_NEW(a,double,(size_t)d->patch_segs*d->patch_b);
+  arena_release(a,mark);
+  peak_table_carve(&L->peaks,a,d->Kd);
+  arena_release(a,mark);
+  if(d->ord_M){                     // after the Hz detection; reads the decimated envelope
+    if(d->fixed) L->ord_xq=ARENA_NEW(a,q15,d->ord_cap); else L->ord_x=ARENA_NEW(a,double,d->ord_cap);
+    L->f_ord=ARENA_NEW(a,double,d->ord_K); L->P_ord=ARENA_NEW(a,double,d->ord_K);
+    welch_scratch_carve(&L->ord_welch,a,d->ord_n,d->T,d->fixed);
+    peak_table_carve(&L->ord_peaks,a,d->ord_K);
+    arena_release(a,mark);
+  }
+}
+
+static size_t ws_bytes(const WsDims *d){ Arena a; arena_sizing(&a); WsLayout L; ws_layout(&L,&a,d); return a.peak; }
+
+/* Sizes (growing the block if needed) and carves the workspace for d. */
+static void ws_prepare(Workspace *w, WsLayout *L, const WsDims *d){
+  size_t need=ws_bytes(d);
+  if(need>w->cap){ free(w->block); w->block=arena_block(need); w->cap=need; }
+  Arena a; arena_attach(&a,w->block,w->cap); ws_layout(L,&a,d);
+}
+
+static void ws_free(Workspace *w){ free(w->block); w->block=NULL; w->cap=0; }
+
+static void ws_tables(WsTables *t, PlanCache *pc, const Config *cfg, const WsDims *d){
+  memset(t,0,sizeof(*t));
+  if(d->fixed){
+    t->h_q=cache_fir_q15(pc,cfg); q15_fft_init(&t->fq_env,pc,d->Np);
+    t->hann_q=cache_hann_q15(pc,d->nd); q15_fft_init(&t->fq_seg,pc,d->nd);
+  } else {
+    t->h=cache_fir(pc,cfg); t->fir_plan=d->fir_M? cache_plan(pc,d->fir_M) : NULL;
+    t->env_plan=cache_plan(pc,d->Np); t->seg_plan=cache_plan(pc,d->nd); t->hann=cache_hann(pc,d->nd);
+  }
+  if(d->ord_M){
+    if(d->fixed){ t->ord_hann_q=cache_hann_q15(pc,d->ord_n); q15_fft_init(&t->fq_ord,pc,d->ord_n); }
+    else { t->ord_plan=cache_plan(pc,d->ord_n); t->ord_hann=cache_hann(pc,d->ord_n); }
+  }
+}
+
+/* Synthetic capture: BPFO-modulated 5 kHz carrier at 20 dB SNR plus a square tach. */
+void rfd_synth(const BearingGeom *geom, double fs, int N, double *acc, double *tach){
+  double fr=fr_hz(geom), f_bpfo=bpfo_hz(geom), fc=5000.0, m=0.5, snr_db=20.0;
+  double sig_pow=0.0; srand(7);
+  for(int i=0;i<N;i++){
+    double t=i/fs; double s=(1.0 + m*sin(2*M_PI*f_bpfo*t)) * sin(2*M_PI*fc*t);
+    acc[i]=s; sig_pow+=s*s;
+    double ph = fmod(2*M_PI*fr*t, 2*M_PI); if(tach) tach[i] = (ph < M_PI)? 0.0 : 1.0;
+  }
+  sig_pow/=N; double noise_pow = sig_pow / pow(10.0, snr_db/10.0);
+  for(int i=0;i<N;i++){ double u1=((double)rand()+1.0)/(RAND_MAX+1.0); double u2=((double)rand()+1.0)/(RAND_MAX+1.0);
+    double z=sqrt(-2.0*log(u1))*cos(2*M_PI*u2); acc[i]+= z*sqrt(noise_pow); }
+}
+
+/* --export-patch: patch_b bands with log-spaced edges over [patch_lo, patch_hi] (capped at
+   the envelope Nyquist) on the Welch segment bins; a band narrower than a bin takes the bin
+   nearest its centre, so none is empty. */
+#define PATCH_FLOOR_DB (-200.0)
+
+static void patch_bands(int *bk, int B, double lo, double hi, double fs_d, int nd){
+  int K=nd/2+1; double df=fs_d/nd;
+  if(hi>fs_d/2) hi=fs_d/2; if(lo<df) lo=df; if(hi<=lo) hi=lo*2.0;
+  for(int b=0;b<B;b++){
+    double e0=lo*pow(hi/lo,(double)b/B), e1=lo*pow(hi/lo,(double)(b+1)/B);
+    int k0=(int)ceil(e0/df), k1=(int)ceil(e1/df);
+    if(k1<=k0){ k0=(int)lround(sqrt(e0*e1)/df); k1=k0+1; }
+    if(k0<1) k0=1; if(k1>K) k1=K; if(k0>=k1) k0=k1-1;
+    bk[2*b]=k0; bk[2*b+1]=k1;
+  }
+}
+
+/* Folds the first S Welch segments (those inside the capture, not its zero padding) into
+   patch_t frames: frame f averages segments [f S/T, (f+1) S/T), or repeats the nearest one
+   when there are fewer segments than frames. Same density scaling as the Welch PSD. */
+static void patch_fold(const WsDims *dm, WsLayout *L, int S, double scale){
+  int T=dm->patch_t, B=dm->patch_b;
+  if(S>dm->patch_segs) S=dm->patch_segs;
+  for(int f=0;f<T;f++){
+    int s0=(int)((long)f*S/T), s1=(int)((long)(f+1)*S/T); if(s1<=s0) s1=s0+1;
+    for(int b=0;b<B;b++){
+      double e=0.0; for(int s=s0;s<s1 && s<S;s++) e+=L->patch_seg[(size_t)s*B+b];
+      double v = S>0? e*scale/((s1-s0)*(L->patch_bk[2*b+1]-L->patch_bk[2*b])) : 0.0;
+      L->patch[(size_t)f*B+b] = (float)(v>0.0? fmax(10.0*log10(v),PATCH_FLOOR_DB) : PATCH_FLOOR_DB);
+    }
+  }
+}
+
+/* DSP stages of one capture into L->f_hz/P_hz (dm->Kd bins); returns the decimated
+   envelope length. The fixed path reads x_q
+   when given (int16 Q15 mapping), else converts acc. pf, when non-NULL, gets a lap per
+   stage. */
+static int dsp_run(const Config *cfg, const WsDims *dm, const WsTables *tb, WsLayout *L,
+                   const double *acc, const q15 *x_q, Perf *pf){
+  int N=dm->N, N2=dm->Np, T=cfg->threads, D=dm->D, Nd;
+  WelchBands wb={ L->patch_bk, dm->patch_b, dm->patch_segs, L->patch_seg }, *pwb=NULL;
+  if(dm->patch_t){ patch_bands(L->patch_bk,dm->patch_b,cfg->patch_lo,cfg->patch_hi,cfg->fs/D,dm->nd); pwb=&wb; }
+  double win_pow=0.0;
+  if(cfg->fixed){
+    // Fixed Q15 path: integer-only (direct-form MACs, table twiddles, 64-bit PSD sums)
+    if(!x_q){ for(int i=0;i<N;i++) L->x_q[i]=q15_from_double(acc[i]); x_q=L->x_q; }
+    fir_q15(x_q,N,tb->h_q,dm->taps,L->y_q,T,L->hr); for(int i=N;i<N2;i++) L->y_q[i]=0;
+    perf_lap(pf,PF_FIR);
+    q15 *env_q=L->y_q; envelope_q15(L->y_q,N2,env_q,&tb->fq_env,T,L->z_q,L->w);
+    perf_lap(pf,PF_ENV);
+    Nd = D>1? decim_apply(&L->dec,env_q,N2) : N2;
+    perf_lap(pf,PF_DECIM);
+    welch_psd_q15(tb->hann_q,&tb->fq_seg,env_q,Nd,dm->nd,dm->nd/2,cfg->fs/D,L->f_hz,L->P_hz,T,&L->welch,pwb);
+    if(pwb) for(int i=0;i<dm->nd;i++) win_pow += (double)((int32_t)tb->hann_q[i]*tb->hann_q[i]);   // Q30
+  } else {
+    // Float path
+    fir_filter(tb->fir_plan,acc,N,tb->h,dm->taps,L->y,T,&L->fir); for(int i=N;i<N2;i++) L->y[i]=0.0;
+    perf_lap(pf,PF_FIR);
+    double *env=L->y; envelope_fft_float(tb->env_plan,L->y,N2,env,T,L->X,L->hx);
+    perf_lap(pf,PF_ENV);
+    Nd = D>1? decim_apply(&L->dec,env,N2) : N2;
+    perf_lap(pf,PF_DECIM);
+    welch_psd_float(tb->seg_plan,tb->hann,env,Nd,dm->nd,dm->nd/2,cfg->fs/D,L->f_hz,L->P_hz,T,&L->welch,pwb);
+    if(pwb) for(int i=0;i<dm->nd;i++) win_pow += tb->hann[i]*tb->hann[i];
+  }
+  if(pwb){                          // segments that end inside the capture (not the FFT padding)
+    int step=dm->nd/2, n_in=(N+D-1)/D, S=0;
+    if(n_in>Nd) n_in=Nd;
+    while((long)S*step+dm->nd<=n_in) S++;
+    if(!S) while((long)S*step+dm->nd<=Nd) S++;
+    patch_fold(dm,L,S,2.0/(win_pow*cfg->fs/D));
+  }
+  perf_lap(pf,PF_WELCH);
+  return Nd;
+}
+
+/* Equal-angle resampling of the decimated envelope (Nd samples, still in L->y / L->y_q)
+   against the tach, then Welch and detection in orders. */
+static void order_run(const Config *cfg, const BearingGeom *g, const WsDims *dm, const WsTables *tb, WsLayout *L,
+                      const double *tach, int Nd, OrderResult *o){
+  memset(o,0,sizeof(*o)); o->M=dm->ord_M; o->nperseg=dm->ord_n;
+  Decimator *dc=&L->dec; long delay=(dm->taps-1)/2;
+  for(int s=0;s<dc->stages;s++) delay += (long)((dc->L[s]-1)/2) << s;
+  AngleResampler r; angle_init(&r,dm->ord_M,dm->D,delay);
+  void *out = dm->fixed? (void*)L->ord_xq : (void*)L->ord_x; long n=0;
+  for(int off=0; off<dm->N; off+=DEC_BLOCK){
+    int c = dm->N-off<DEC_BLOCK? dm->N-off : DEC_BLOCK;
+    angle_push(&r,tach+off,c, dm->fixed? (const void*)L->y_q : (const void*)L->y, Nd, dm->fixed, out, dm->ord_cap, &n);
+  }
+  o->revs=r.revs; o->truncated=r.truncated;
+  if(r.revs){
+    o->rpm_mean=60.0*cfg->fs*r.revs/(double)r.per_sum;
+    o->rpm_min=60.0*cfg->fs/r.per_max; o->rpm_max=60.0*cfg->fs/r.per_min;
+  }
+  int no=(int)n, T=cfg->threads;
+  if(dm->fixed) welch_psd_q15(tb->ord_hann_q,&tb->fq_ord,L->ord_xq,no,dm->ord_n,dm->ord_n/2,dm->ord_M,L->f_ord,L->P_ord,T,&L->ord_welch,NULL);
+  else welch_psd_float(tb->ord_plan,tb->ord_hann,L->ord_x,no,dm->ord_n,dm->ord_n/2,dm->ord_M,L->f_ord,L->P_ord,T,&L->ord_welch,NULL);
+  BearingGeom gu=*g; gu.rpm=60.0;                       // fr = 1: predictions in orders
+  peak_table_build(&L->ord_peaks,L->f_ord,L->P_ord,dm->ord_K); detect_hz(&gu,&L->ord_peaks,&o->det);
+}
+
+/* ---------------- Context ----------------
+   One window: (Q15 monitor) -> gate -> (kurtogram) -> DSP -> detect -> (order). Setup that
+   depends only on the parameters (taps, windows, plans) comes from the cache, shared
+   between contexts when the caller passes one; the workspace block only grows. */
+struct RfdContext {
+  Config cfg, run;                // settings as configured / as the last window ran
+  BearingGeom geom;
+  PlanCache *pc; int own_pc;
+  Workspace ws; WsLayout L; WsDims dm; WsTables tb;
+  int have_tb; double tb_fs;      // tb matches dm and fs (reused while the window shape holds)
+  GateBase gate_base; GateResult gate; double feat[GATE_NF];
+  OrderResult ord; Q15Mon mon;
+  Perf perf; int perf_live;
+  ParPool *pool;                  // cfg.threads-1 workers, bound to the caller per window
+};
+
+PlanCache *rfd_cache_create(void){ PlanCache *pc=(PlanCache*)malloc(sizeof(PlanCache)); if(pc) cache_init(pc); return pc; }
+void rfd_cache_destroy(PlanCache *pc){ if(pc){ cache_free(pc); free(pc); } }
+
+RfdContext *rfd_create(const Config *cfg, const BearingGeom *g, PlanCache *shared){
+  RfdContext *c=(RfdContext*)calloc(1,sizeof(RfdContext)); if(!c) return NULL;
+  c->pc = shared? shared : rfd_cache_create(); c->own_pc = !shared;
+  if(!c->pc){ free(c); return NULL; }
+  rfd_configure(c,cfg,g);
+  return c;
+}
+
+int rfd_configure(RfdContext *c, const Config *cfg, const BearingGeom *g){
+  int threads=c->pool? c->pool->n : 1;
+  c->cfg=*cfg; c->geom=*g; c->have_tb=0;
+  if(cfg->threads!=threads){ par_pool_destroy(c->pool); c->pool=par_pool_create(cfg->threads); }
+  return 0;
+}
+
+void rfd_destroy(RfdContext *c){
+  if(!c) return;
+  ws_free(&c->ws); if(c->own_pc) rfd_cache_destroy(c->pc);
+  par_pool_destroy(c->pool);
+  free(c);
+}
+
+Perf *rfd_profile_begin(RfdContext *c){
+  if(!c->cfg.profile) return NULL;
+  perf_start(&c->perf); c->perf_live=1; return &c->perf;
+}
+
+GateBase *rfd_gate_base(RfdContext *c){ return &c->gate_base; }
+
+static int same_dims(const WsDims *a, const WsDims *b){ return memcmp(a,b,sizeof(*a))==0; }
+
+static int process_window(RfdContext *c, const RfdWindow *w, RfdResult *r){
+  Config *cfg=&c->run; const BearingGeom *geom=&c->geom;
+  Perf *pf = c->perf_live? &c->perf : rfd_profile_begin(c); c->perf_live=0;
+  *cfg=c->cfg;
+  if(w->fs>0.0) cfg->fs=w->fs;
+  if(w->pod_id>=0) cfg->pod_id=w->pod_id;
+  int N=w->n; const double *acc=w->acc, *tach=w->tach; const q15 *x_q_ext=(const q15*)w->acc_q15;
+  if(N<=0 || (!acc && !(x_q_ext && cfg->fixed))){ fprintf(stderr,"rfd_process_window: empty window\n"); return 1; }
+  if((int)(cfg->fs*cfg->duration_s)!=N) cfg->duration_s=N/cfg->fs;
+  memset(r,0,sizeof(*r)); r->cfg=cfg; r->geom=geom; r->perf=pf;
+
+  // Q15 monitor
+  Q15Mon *mon=&c->mon; mon->overflows=0; mon->peak_abs=0.0;
+  if(cfg->q15simulate && x_q_ext){ for(int i=0;i<N;i++){ double v=fabs(q15_to_double(x_q_ext[i])); if(v>mon->peak_abs) mon->peak_abs=v; if(x_q_ext[i]==-32768) mon->overflows++; } }
+  else if(cfg->q15simulate){ for(int i=0;i<N;i++){ double v=acc[i]; if(fabs(v)>mon->peak_abs) mon->peak_abs=fabs(v); if(v<=-1.0 || v>=1.0) mon->overflows++; } }
+  if(cfg->q15simulate) r->q15=mon;
+  perf_lap(pf,PF_LOAD);
+
+  // Gate: healthy-looking windows stop here
+  GateResult *gate = cfg->gate? &c->gate : NULL;
+  if(gate){
+    gate->window=c->gate_base.windows;
+    gate_features(acc,x_q_ext,N,gate->f); gate_decide(cfg,&c->gate_base,gate);
+    perf_lap(pf,PF_GATE);
+    r->gate=gate; r->features=gate->f;
+    if(!gate->run_full){
+      Detections *det=&r->det;
+      det->fr=fr_hz(geom); det->bpfo=bpfo_hz(geom); det->bpfi=bpfi_hz(geom); det->bsf=bsf_hz(geom); det->ftf=ftf_hz(geom);
+      det->fault="unknown"; snprintf(det->rationale,sizeof(det->rationale),"gated: %s", gate->reason);
+      rfd_gate_fold(&c->gate_base,gate);
+      return 0;
+    }
+  } else if(cfg->features){
+    gate_features(acc,x_q_ext,N,c->feat); r->features=c->feat;
+    perf_lap(pf,PF_GATE);
+  }
+
+  // DSP
+  if(cfg->enable_order && !tach){ fprintf(stderr,"--order needs a tach channel (acc,tach CSV or 2-channel capture); %s has none\n", cfg->input[0]? cfg->input : "input"); cfg->enable_order=0; }
+  WsDims dm; ws_dims(&dm,cfg,geom,N);
+  if(!same_dims(&dm,&c->dm) || cfg->fs!=c->tb_fs || dm.kurt_L>=0) c->have_tb=0;
+  c->dm=dm; c->tb_fs=cfg->fs;
+  WsLayout *L=&c->L; ws_prepare(&c->ws,L,&dm);
+  if(dm.kurt_L>=0){                 // the band-pass taps below depend on the band it picks
+    perf_lap(pf,PF_SETUP);
+    kurtogram_run(&L->kurt,cfg,geom,N,acc,x_q_ext,L->kurt_x,L->kurt_buf,L->kurt_tmp);
+    cfg->band_lo=L->kurt.lo; cfg->band_hi=L->kurt.hi;
+    perf_lap(pf,PF_KURT);
+    r->kurtogram=&L->kurt;
+  }
+  if(!c->have_tb){ ws_tables(&c->tb,c->pc,cfg,&dm); c->have_tb=1; }
+  cfg->decim_used=dm.D;
+  if(pf){ pf->workspace=ws_bytes(&dm); pf->signal_s=N/cfg->fs; }
+  perf_lap(pf,PF_SETUP);
+  int Nd=dsp_run(cfg,&dm,&c->tb,L,acc,x_q_ext,pf);
+
+  // Predictions, detections, decision
+  Detections *det=&r->det; peak_table_build(&L->peaks,L->f_hz,L->P_hz,dm.Kd); detect_hz(geom,&L->peaks,det);
+  r->f_hz=L->f_hz; r->psd=L->P_hz; r->bins=dm.Kd;
+  if(dm.patch_t){ r->patch=L->patch; r->patch_t=dm.patch_t; r->patch_b=dm.patch_b; }
+  if(L->bearings.e){ detect_set(cfg,geom,&L->peaks,&L->bearings); r->bearings=&L->bearings; }
+  perf_lap(pf,PF_DETECT);
+  if(dm.ord_M){
+    OrderResult *ord=&c->ord; order_run(cfg,geom,&dm,&c->tb,L,tach,Nd,ord); r->order=ord;
+    if(ord->det.conf>det->conf){ det->fault=ord->det.fault; det->conf=ord->det.conf; strcpy(det->rationale,"BPFO matched in order spectrum"); }
+  } else if(cfg->enable_order) fprintf(stderr,"Capture too short for order tracking (%d revolutions per segment needed)\n", ORD_MIN_REVS);
+  perf_lap(pf,PF_ORDER);
+  if(gate){ gate->fault = strcmp(det->fault,"unknown")!=0; rfd_gate_fold(&c->gate_base,gate); }
+  return 0;
+}
+
+int rfd_process_window(RfdContext *c, const RfdWindow *w, RfdResult *r){
+  ParPool *prev=par_pool; par_pool=c->pool;
+  int rc=process_window(c,w,r);
+  par_pool=prev;
+  return rc;
+}
+
+/* Sizes for N samples under cfg, without running the DSP (--workspace-bytes). */
+int rfd_sizes(const Config *cfg, const BearingGeom *g, int N, RfdSizes *s){
+  WsDims d; ws_dims(&d,cfg,g,N);
+  PlanCache pc; cache_init(&pc); WsTables t; ws_tables(&t,&pc,cfg,&d);
+  s->workspace=ws_bytes(&d); s->tables_heap=cache_bytes(&pc,1); s->tables_static=cache_bytes(&pc,0);
+  s->N=N; s->Np=d.Np; s->nperseg=d.nd; s->decimation=d.D; s->threads=d.T; s->fixed=d.fixed;
+  cache_free(&pc);
+  return 0;
+}
@@ -0,0 +1,212 @@
+/*
+  rotorfd.h — librotorfd: the rotor_fd pipeline as an embeddable library
+  - rfd_create() builds a context once from Config/BearingGeom: FIR taps, windows, FFT plans
+    (in a setup cache that contexts may share) and the workspace block
+  - rfd_process_window() runs gate -> (kurtogram) -> FIR -> envelope -> Welch -> detections
+    (-> order tracking) on one window and fills an RfdResult; nothing is set up again
+    while windows keep the same length
+  - rfd_write_json() (rotorfd_json.c) is the optional JSON record writer used by rotor_fd
+  The context is not thread-safe; use one per thread (they can share a PlanCache).
+*/
+#ifndef ROTOR_FD_ROTORFD_H
+#define ROTOR_FD_ROTORFD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+  int   n;        // rolling elements
+  double d;       // ball dia [m]
+  double D;       // pitch dia [m]
+  double beta;    // contact angle [rad]
+  double rpm;     // nominal rpm
+  char name[24];  // label in the per-bearing tables
+} BearingGeom;
+
+#define FIR_FFT_MIN_TAPS 64   // tap count from which the float FIR uses overlap-save
+#define MAX_BEARINGS  8    // --geom may be repeated for bearings on one shaft
+#define MAX_RPM_STEPS 65   // --rpm-sweep grid points
+
+typedef struct {
+  double fs;
+  double duration_s;
+  double band_lo, band_hi;
+  int    nperseg;
+  int    taps;           // band-pass FIR length (odd)
+  int    enable_order;
+  int    q15simulate;
+  int    fixed;          // strict fixed-point pipeline
+  int    stream;         // continuous mode: CSV lines from stdin / FIFO
+  int    emit_every;     // stream: Welch segments per JSON record
+  char   input[512];
+  char   out_json[512];
+  char   name[128];
+  char   synth[256];     // --synth: generator spec for the synthetic input (synth.h; empty: rfd_synth)
+  long   pod_id;         // from a binary capture header, -1 if unknown
+  char   batch[512];     // manifest path for batch mode
+  int    threads;        // DSP threads (FIR/envelope/Welch); batch worker threads
+  int    batch_sweep;    // batch: report throughput for 1..threads
+  int    simd;           // Q15 kernel set (Q15K_*), auto-detected by default
+  int    decimate;       // post-envelope decimation: 0 auto, 1 off, else factor
+  int    decim_used;     // factor applied to the last spectrum (reported in JSON)
+  int    ws_query;       // print the workspace size for this configuration and exit
+  int    profile;        // add per-stage timing and memory ("perf") to each record
+  BearingGeom more[MAX_BEARINGS-1];   // bearings after the first --geom, matched against the same spectrum
+  int    nmore;
+  double sweep_pct;      // --rpm-sweep: +-pct around each bearing's rpm ...
+  int    sweep_steps;    // ... in this many points (0 = off)
+  int    auto_band;      // --auto-band: band-pass from the fast kurtogram
+  int    kurt_levels;    // kurtogram depth (0 = finest band that still holds the fault sidebands)
+  int    gate;           // --gate: time-domain features decide whether the spectral path runs
+  double gate_th[4];     // rms, peak, crest, kurtosis thresholds (0 = off)
+  double gate_dev;       // baseline deviation, in standard deviations
+  int    gate_every;     // forced full check every K windows (0 = never)
+  char   gate_state[512];  // baseline file (empty: thresholds and cadence only)
+  char   serve[256];     // --serve udp:[host:]port | unix:path (gateway receiver)
+  int    serve_pods;     // pod table size
+  long   serve_windows;  // stop after this many records (0: until SIGINT/SIGTERM)
+  double serve_stats;    // seconds between windows/s and latency reports (0: at exit only)
+  int    features;       // time-domain features without --gate (trend log, export)
+  char   trend_log[512]; // --trend-log: append one record per window
+  char   trend[512];     // --trend: query this log and exit
+  long   trend_asset;    // query: one asset (-1 = all)
+  double trend_since, trend_until;   // query: unix seconds (0 = open)
+  int    trend_bins;     // query: series buckets
+  char   export_file[512];   // --export: packed int8 feature records (export.h)
+  char   export_quant[512];  // --export-quant: scale/zero-point table (empty: built-in ranges)
+  int    patch_t, patch_b;   // --export-patch: envelope STFT patch, frames x log bands (0 = off)
+  double patch_lo, patch_hi; // --patch-hz: span of the log bands [Hz]
+} Config;
+
+/* ---------------- Results ---------------- */
+typedef struct { int found; int index; double freq; double snr_db; double df; int harmonic; } PeakHit;
+
+/* Predictions + Hz-domain detections + decision for one spectrum */
+typedef struct {
+  double fr, bpfo, bpfi, bsf, ftf;
+  PeakHit hz_bpfo, hz_bpfi, hz_bsf, hz_ftf;
+  const char *fault; double conf; char rationale[128];
+} Detections;
+
+typedef struct { BearingGeom g; Detections det; } BearingEval;
+typedef struct { BearingEval *e; int nb, steps, best[MAX_BEARINGS]; } BearingSet;
+
+/* Order-domain result: detections in orders of the shaft speed (fr = 1). */
+typedef struct {
+  int M, nperseg; long revs; int truncated;
+  double rpm_mean, rpm_min, rpm_max;
+  Detections det;
+} OrderResult;
+
+#define KURT_MAX_LEVELS 10
+#define KURT_MAX_ROWS   (2*KURT_MAX_LEVELS)
+
+typedef struct {
+  int L, rows, nodes;                 // binary levels 0..L and thirds 1.6..L-0.4: 2L rows (1 for L=0)
+  int bands[KURT_MAX_ROWS], off[KURT_MAX_ROWS];
+  double *sk;                         // kurtosis, row by row (off[r] + band)
+  double fs, bw_min;                  // bands narrower than bw_min cannot carry the fault sidebands
+  int row, band; double lo, hi, best; // selected node
+} Kurtogram;
+
+#define GATE_NF 4                     // rms, peak, crest, kurtosis (Config::gate_th order)
+
+typedef struct { long windows, n; double mean[GATE_NF], m2[GATE_NF]; } GateBase;
+
+typedef struct {
+  long window;                // this window's index in the baseline's count
+  double f[GATE_NF];
+  int run_full, fault;        // spectral path ran; it found a fault (kept out of the baseline)
+  long baseline_n; char reason[80];
+} GateResult;
+
+typedef struct { int overflows; double peak_abs; } Q15Mon;
+
+typedef struct { long segment; long segments_in_record; double t_end_s; } StreamInfo;
+
+/* --profile: wall-clock seconds and cycles per stage, heap high-water mark. */
+enum { PF_LOAD, PF_GATE, PF_SETUP, PF_KURT, PF_FIR, PF_ENV, PF_DECIM, PF_WELCH, PF_DETECT, PF_ORDER, PF_JSON, PF_STAGES };
+
+typedef struct {
+  double s[PF_STAGES]; uint64_t cyc[PF_STAGES];
+  double t; uint64_t c;                 // last lap
+  size_t heap_peak, workspace; double signal_s;
+} Perf;
+
+extern const char *const rfd_perf_stage[PF_STAGES];
+extern const char *const rfd_gate_feature[GATE_NF];
+
+/* One window of samples; fs 0 keeps the context's, pod_id -1 if unknown. */
+typedef struct {
+  const double  *acc;         // samples in physical units, or NULL with acc_q15
+  const int16_t *acc_q15;     // --fixed only: Q15 counts (int16 capture, scale 1/32768), read in place
+  const double  *tach;        // NULL when there is no tach channel
+  int n; double fs; long pod_id;
+} RfdWindow;
+
+/* Pointers refer into the context and stay valid until its next window, rfd_configure()
+   or rfd_destroy(); NULL when that part did not run. */
+typedef struct {
+  const Config *cfg;          // settings the window ran with (fs, band, decimation used)
+  const BearingGeom *geom;
+  Detections det;             // predictions, Hz detections, decision (order match folded in)
+  const OrderResult *order;
+  const Kurtogram *kurtogram;
+  const BearingSet *bearings; // several --geom or --rpm-sweep
+  const GateResult *gate;
+  const Q15Mon *q15;
+  const StreamInfo *stream;
+  Perf *perf;                 // the JSON writer adds its own lap
+  const double *features;     // rms, peak, crest, kurtosis (Config::gate or ::features)
+  const double *f_hz, *psd;   // envelope spectrum the detections came from (NULL when gated)
+  int bins;
+  const float *patch;         // Config::patch_t frames x patch_b bands, mean PSD in dB, frame-major (NULL when gated)
+  int patch_t, patch_b;
+} RfdResult;
+
+/* Exact per-window sizes for a configuration (see --workspace-bytes). */
+typedef struct { size_t workspace, tables_heap, tables_static; int N, Np, nperseg, decimation, threads, fixed; } RfdSizes;
+
+typedef struct PlanCache PlanCache;
+typedef struct RfdContext RfdContext;
+
+void rfd_defaults(Config *c, BearingGeom *g);
+
+PlanCache *rfd_cache_create(void);
+void rfd_cache_destroy(PlanCache *pc);
+
+/* shared: a cache used by several contexts (NULL for a private one). Setup is built by the
+   first window and kept while later ones have the same length and rate. NULL on failure. */
+RfdContext *rfd_create(const Config *cfg, const BearingGeom *g, PlanCache *shared);
+/* New settings for later windows; keeps the cache, workspace and gate baseline. */
+int  rfd_configure(RfdContext *c, const Config *cfg, const BearingGeom *g);
+void rfd_destroy(RfdContext *c);
+
+/* Starts --profile accounting before the caller loads a window (returns NULL when off);
+   otherwise rfd_process_window starts it. */
+Perf *rfd_profile_begin(RfdContext *c);
+void rfd_perf_lap(Perf *p, int stage);
+
+/* 0 on success. With cfg->gate the window is folded into the context's baseline. */
+int rfd_process_window(RfdContext *c, const RfdWindow *w, RfdResult *r);
+
+/* --gate baseline: held by the context, loaded/saved by the caller. */
+GateBase *rfd_gate_base(RfdContext *c);
+int  rfd_gate_load(const char *path, GateBase *b);    // a missing file is a fresh baseline
+int  rfd_gate_save(const char *path, const GateBase *b);
+void rfd_gate_fold(GateBase *b, const GateResult *r);
+
+int  rfd_sizes(const Config *cfg, const BearingGeom *g, int N, RfdSizes *s);
+int  rfd_fft_len(int n);     // smallest valid --nperseg / FFT length >= n (even, 2/3/5-smooth)
+
+/* Synthetic capture: BPFO-modulated 5 kHz carrier at 20 dB SNR plus a square tach (may be NULL). */
+void rfd_synth(const BearingGeom *g, double fs, int N, double *acc, double *tach);
+
+/* Continuous mode (float): samples from `in` (CSV lines or a binary capture), records to `out`. */
+int  rfd_run_stream(const Config *cfg, const BearingGeom *g, FILE *in, FILE *out);
+
+/* rotorfd_json.c */
+void rfd_write_json(FILE *f, const RfdResult *r);
+
+#endif
@@ -0,0 +1,123 @@
+/*
+  rotorfd_json.c — librotorfd add-on: one diagnostic JSON record per RfdResult
+  (the format rotor_fd writes; see README "Output"). Link it only where records are
+  written; the pipeline itself does not need it except for the stream front end.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#include "rotorfd.h"
+#include "perf_port.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static void write_perf(FILE *f, const Perf *p){
+  double tot=0.0; uint64_t ctot=0;
+  fprintf(f,"  \"perf\": {\"cycle_counter\": \"%s\", \"stages\": {", PERF_CYCLE_SOURCE);
+  for(int k=0;k<PF_STAGES;k++){
+    fprintf(f,"%s\"%s\": {\"ms\": %.4f, \"cycles\": %llu}", k? ", " : "", rfd_perf_stage[k], p->s[k]*1e3, (unsigned long long)p->cyc[k]);
+    tot+=p->s[k]; ctot+=p->cyc[k];
+  }
+  fprintf(f,"},\n    \"total_ms\": %.4f, \"total_cycles\": %llu, \"signal_s\": %.6f, \"realtime_ratio\": %.6f, \"heap_peak_bytes\": %zu, \"workspace_bytes\": %zu},\n",
+    tot*1e3, (unsigned long long)ctot, p->signal_s, p->signal_s>0.0? tot/p->signal_s : 0.0, p->heap_peak, p->workspace);
+}
+
+static void write_hit(FILE *f, const char *name, PeakHit h, const char *trail){
+  if(h.found) fprintf(f,"\"%s\": {\"freq\": %.6f, \"snr_db\": %.6f, \"harmonic\": %d}%s", name, h.freq, h.snr_db, h.harmonic, trail);
+  else fprintf(f,"\"%s\": null%s", name, trail);
+}
+
+/* Per-bearing tables: geometry, best speed, then one line per sweep point. */
+static void write_bearings(FILE *f, const BearingSet *s){
+  fprintf(f,"  \"bearings\": [\n");
+  for(int b=0;b<s->nb;b++){
+    const BearingEval *e0=&s->e[b*s->steps], *be=&s->e[s->best[b]];
+    const BearingGeom *g=&e0->g;
+    fprintf(f,"    {\"name\": \"%s\", \"geometry\": {\"n\": %d, \"d\": %.6f, \"D\": %.6f, \"beta_deg\": %.2f},\n",
+      g->name, g->n, g->d, g->D, g->beta*180.0/M_PI);
+    fprintf(f,"     \"best\": {\"rpm\": %.2f, \"fault_class\": \"%s\", \"confidence\": %.3f},\n     \"sweep\": [\n",
+      be->g.rpm, be->det.fault, be->det.conf);
+    for(int k=0;k<s->steps;k++){
+      const BearingEval *e=&s->e[b*s->steps+k]; const Detections *d=&e->det;
+      fprintf(f,"       {\"rpm\": %.2f, \"predictions_hz\": {\"fr\": %.6f, \"BPFO\": %.6f, \"BPFI\": %.6f, \"BSF\": %.6f, \"FTF\": %.6f},\n        \"detections_hz\": {",
+        e->g.rpm, d->fr, d->bpfo, d->bpfi, d->bsf, d->ftf);
+      write_hit(f,"BPFO",d->hz_bpfo,", "); write_hit(f,"BPFI",d->hz_bpfi,", "); write_hit(f,"BSF",d->hz_bsf,", "); write_hit(f,"FTF",d->hz_ftf,"");
+      fprintf(f,"}, \"fault_class\": \"%s\", \"confidence\": %.3f}%s\n", d->fault, d->conf, k+1<s->steps? "," : "");
+    }
+    fprintf(f,"     ]}%s\n", b+1<s->nb? "," : "");
+  }
+  fprintf(f,"  ],\n");
+}
+
+/* Selected band, then the kurtosis map one row per level (0, 1, 1.6, 2, 2.6, ...). */
+static void write_kurtogram(FILE *f, const Kurtogram *k){
+  fprintf(f,"  \"kurtogram\": {\"levels\": %d, \"min_band_hz\": %.1f, \"selected\": {\"level\": %.1f, \"band_hz\": [%.1f, %.1f], \"kurtosis\": %.4f},\n    \"map\": [\n",
+    k->L, k->bw_min, log2(k->bands[k->row]), k->lo, k->hi, k->best);
+  for(int r=0;r<k->rows;r++){
+    fprintf(f,"      {\"level\": %.1f, \"bw_hz\": %.1f, \"kurtosis\": [", log2(k->bands[r]), k->fs/(2.0*k->bands[r]));
+    for(int i=0;i<k->bands[r];i++) fprintf(f,"%s%.4f", i? ", " : "", k->sk[k->off[r]+i]);
+    fprintf(f,"]}%s\n", r+1<k->rows? "," : "");
+  }
+  fprintf(f,"    ]},\n");
+}
+
+void rfd_write_json(FILE *f, const RfdResult *r){
+  const Config *cfg=r->cfg; const BearingGeom *g=r->geom; const Detections *d=&r->det;
+  const OrderResult *ord=r->order; const GateResult *gate=r->gate;
+  time_t now=time(NULL);
+  fprintf(f,"{\n");
+  if(cfg->pod_id>=0) fprintf(f,"  \"run\": {\"timestamp\": %ld, \"name\": \"%s\", \"pod_id\": %ld},\n", (long)now, cfg->name, cfg->pod_id);
+  else fprintf(f,"  \"run\": {\"timestamp\": %ld, \"name\": \"%s\"},\n", (long)now, cfg->name);
+  fprintf(f,"  \"signal\": {\"fs_hz\": %.6f, \"duration_s\": %.6f, \"window\": \"hann\", \"nperseg\": %d, \"band_hz\": [%.1f, %.1f], \"order_tracking\": %s, \"fixed\": %s, \"decimation\": %d},\n",
+    cfg->fs, cfg->duration_s, cfg->nperseg, cfg->band_lo, cfg->band_hi, cfg->enable_order? "true":"false", cfg->fixed? "true":"false", cfg->decim_used);
+  if(gate){
+    fprintf(f,"  \"gate\": {\"gated\": %s, \"reason\": \"%s\", \"window\": %ld, \"baseline_windows\": %ld",
+      gate->run_full? "false" : "true", gate->reason, gate->window, gate->baseline_n);
+    for(int k=0;k<GATE_NF;k++) fprintf(f,", \"%s\": %.6f", rfd_gate_feature[k], gate->f[k]);
+    fprintf(f,"},\n");
+  }
+  if(r->kurtogram) write_kurtogram(f,r->kurtogram);
+  fprintf(f,"  \"geometry\": {\"n\": %d, \"d\": %.6f, \"D\": %.6f, \"beta_deg\": %.2f, \"rpm\": %.2f},\n",
+    g->n, g->d, g->D, g->beta*180.0/M_PI, g->rpm);
+  fprintf(f,"  \"predictions_hz\": {\"fr\": %.6f, \"BPFO\": %.6f, \"BPFI\": %.6f, \"BSF\": %.6f, \"FTF\": %.6f},\n",
+    d->fr, d->bpfo, d->bpfi, d->bsf, d->ftf);
+
+  #define WRITE_HZ(name,h,trail) do { \
+    if((h).found) fprintf(f,"    \"" name "\": {\"freq\": %.6f, \"snr_db\": %.6f, \"df\": %.6f, \"harmonic\": %d}%s\n",(h).freq,(h).snr_db,(h).df,(h).harmonic, trail); \
+    else fprintf(f,"    \"" name "\": null%s\n", trail); } while(0)
+
+  fprintf(f,"  \"detections_hz\": {\n");
+  WRITE_HZ("BPFO", d->hz_bpfo, ",");
+  WRITE_HZ("BPFI", d->hz_bpfi, ",");
+  WRITE_HZ("BSF",  d->hz_bsf,  ",");
+  WRITE_HZ("FTF",  d->hz_ftf,  "");
+  fprintf(f,"  },\n");
+
+  if(ord){
+    fprintf(f,"  \"order\": {\"samples_per_rev\": %d, \"nperseg\": %d, \"revolutions\": %ld, \"truncated\": %s, \"rpm_mean\": %.2f, \"rpm_min\": %.2f, \"rpm_max\": %.2f},\n",
+      ord->M, ord->nperseg, ord->revs, ord->truncated? "true" : "false", ord->rpm_mean, ord->rpm_min, ord->rpm_max);
+    fprintf(f,"  \"predictions_order\": {\"BPFO\": %.6f, \"BPFI\": %.6f, \"BSF\": %.6f, \"FTF\": %.6f},\n",
+      ord->det.bpfo, ord->det.bpfi, ord->det.bsf, ord->det.ftf);
+    fprintf(f,"  \"detections_order\": {\n");
+    WRITE_HZ("BPFO", ord->det.hz_bpfo, ",");
+    WRITE_HZ("BPFI", ord->det.hz_bpfi, ",");
+    WRITE_HZ("BSF",  ord->det.hz_bsf,  ",");
+    WRITE_HZ("FTF",  ord->det.hz_ftf,  "");
+    fprintf(f,"  },\n");
+  }
+
+  if(r->bearings) write_bearings(f,r->bearings);
+  if(r->q15){ fprintf(f,"  \"q15\": {\"peak_abs\": %.6f, \"overflow_events\": %d},\n", r->q15->peak_abs, r->q15->overflows); }
+  if(r->stream){ const StreamInfo *st=r->stream; fprintf(f,"  \"stream\": {\"segment\": %ld, \"segments_in_record\": %ld, \"t_end_s\": %.6f},\n", st->segment, st->segments_in_record, st->t_end_s); }
+  if(r->perf){ rfd_perf_lap(r->perf,PF_JSON); write_perf(f,r->perf); }   // json = formatting up to here
+
+  fprintf(f,"  \"decision\": {\"fault_class\": \"%s\", \"confidence\": %.3f, \"rationale\": \"%s\"}\n", d->fault, d->conf, d->rationale);
+  fprintf(f,"}\n");
+  fflush(f);
+}
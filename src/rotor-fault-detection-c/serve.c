@@ -0,0 +1,329 @@
+/*
+  serve.c — rotor_fd --serve: long-running gateway receiver (Linux, epoll)
+  - Receiver thread: epoll over the socket, a stats timer, SIGINT/SIGTERM (signalfd) and a
+    done event; datagrams are read in batches with recvmmsg
+  - Per pod: a ring of SERVE_SLOTS preallocated windows of fs*duration samples. Packet
+    samples are copied straight into the slot being filled; a sequence gap or a new rate
+    restarts the window, and a pod whose slots are all still queued skips a window
+  - Completed windows go through a queue to --threads DSP workers, each with its own
+    librotorfd context over one shared setup cache; records leave as JSON lines
+  - Latency: packet that completed the window -> record written ("lat"), and last sample
+    (pod clock) -> record written ("age", meaningful when the pod clocks are synced)
+  - --trend-log / --export: every record is also appended to the trend log and the feature
+    export, stamped with the pod clock
+*/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE   // recvmmsg
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+#include "serve.h"
+#include "capture.h"
+#include "trend.h"
+#include "export.h"
+
+#define SERVE_SLOTS 4        // windows per pod: one filling, the rest queued or in DSP
+#define SERVE_BATCH 32       // datagrams per recvmmsg
+#define SERVE_LAT   65536    // latency samples kept for the percentiles
+#define SERVE_PKT   (PKT_HEADER_BYTES + 2*PKT_MAX_SAMPLES)
+#define SERVE_MAX_W (1<<22)  // samples per window (4 slots of 8 MiB per pod at most)
+
+typedef struct {
+  int16_t *x; int n;          // samples of a completed window
+  uint64_t t_us;              // first sample, pod clock
+  long index;                 // window number for this pod
+  double t_recv;              // arrival of the packet that completed it (monotonic)
+  float fs, scale;
+  atomic_int busy;            // queued or in DSP: the receiver leaves it alone
+} ServeSlot;
+
+typedef struct {
+  uint32_t id; int used;
+  uint32_t seq_next; float fs, scale; int W, cap;   // window length, slot capacity
+  ServeSlot slot[SERVE_SLOTS];
+  int cur, next, fill;        // slot being filled (-1: skipping a window), next to try, samples so far
+  long windows;
+  pthread_mutex_t lock; GateBase gate;              // --gate: this pod's baseline
+} ServePod;
+
+typedef struct { int pod, slot; } ServeItem;
+
+typedef struct {
+  Config cfg; BearingGeom geom; FILE *out;
+  ServePod *pods; int npods;
+  PlanCache *pc;
+  TrendStore *trend;                                // --trend-log, NULL without
+  ExportFile *xf;                                   // --export, NULL without
+  pthread_mutex_t qlock; pthread_cond_t qcond;      // completed windows, FIFO
+  ServeItem *q; int qcap, qhead, qlen, stop;
+  pthread_mutex_t olock;                            // output and stats
+  long records, failed; double lat[SERVE_LAT], age[SERVE_LAT];
+  long packets, bad, gaps, dropped, rejected;       // receiver thread only
+  int done_fd;
+} Serve;
+
+static double mono_s(void){ struct timespec ts; clock_gettime(CLOCK_MONOTONIC,&ts); return ts.tv_sec + ts.tv_nsec*1e-9; }
+static double real_s(void){ struct timespec ts; clock_gettime(CLOCK_REALTIME,&ts); return ts.tv_sec + ts.tv_nsec*1e-9; }
+
+static int cmp_double(const void *a, const void *b){ double x=*(const double*)a, y=*(const double*)b; return (x>y)-(x<y); }
+
+/* Percentiles p50/p99 (ms) of the last n entries of ring v (count total entries so far). */
+static void lat_pct(const double *v, long total, long n, double *tmp, double out[2]){
+  if(n>total) n=total; if(n>SERVE_LAT) n=SERVE_LAT;
+  out[0]=out[1]=0.0; if(n<=0) return;
+  for(long i=0;i<n;i++) tmp[i]=v[(total-n+i)%SERVE_LAT];
+  qsort(tmp,(size_t)n,sizeof(double),cmp_double);
+  long r50=(n+1)/2, r99=(long)((99*n+99)/100); if(r99>n) r99=n;
+  out[0]=tmp[r50-1]*1e3; out[1]=tmp[r99-1]*1e3;
+}
+
+/* ---------------- Queue ---------------- */
+static void queue_push(Serve *s, ServeItem it){
+  pthread_mutex_lock(&s->qlock);
+  s->q[(s->qhead+s->qlen)%s->qcap]=it; s->qlen++;    // never full: one entry per slot at most
+  pthread_cond_signal(&s->qcond); pthread_mutex_unlock(&s->qlock);
+}
+
+/* 0 once stopped and drained. */
+static int queue_pop(Serve *s, ServeItem *it){
+  pthread_mutex_lock(&s->qlock);
+  while(!s->qlen && !s->stop) pthread_cond_wait(&s->qcond,&s->qlock);
+  int ok=s->qlen>0;
+  if(ok){ *it=s->q[s->qhead]; s->qhead=(s->qhead+1)%s->qcap; s->qlen--; }
+  pthread_mutex_unlock(&s->qlock);
+  return ok;
+}
+
+/* ---------------- Receiver ---------------- */
+/* Pod table slot for id (open addressing), registered on first sight; NULL when full. */
+static ServePod *serve_pod(Serve *s, uint32_t id){
+  for(int k=0;k<s->npods;k++){
+    ServePod *p=&s->pods[(int)((id*2654435761u + (uint32_t)k) % (uint32_t)s->npods)];
+    if(!p->used || p->id==id) return p;
+  }
+  return NULL;
+}
+
+static int pod_start(Serve *s, ServePod *p, const PodPacket *h){
+  double w=h->fs_hz*s->cfg.duration_s;             // checked before the cast: fs comes off the network
+  if(!(w>=2.0 && w<=SERVE_MAX_W)) return -1;
+  int W=(int)w;
+  if(!p->used){
+    for(int k=0;k<SERVE_SLOTS;k++){ p->slot[k].x=(int16_t*)malloc(sizeof(int16_t)*W); if(!p->slot[k].x) return -1; }
+    p->cap=W; p->id=h->pod_id; p->used=1; p->cur=-1; p->next=0;
+    pthread_mutex_init(&p->lock,NULL);
+  } else if(W>p->cap) return -1;                    // slots are sized by the first rate seen
+  p->W=W; p->fs=h->fs_hz; p->scale=h->scale; p->fill=0;
+  return 0;
+}
+
+static void serve_packet(Serve *s, const PodPacket *h, const int16_t *x, double t_recv){
+  ServePod *p=serve_pod(s,h->pod_id);
+  if(!p){ s->rejected++; return; }
+  if(!p->used || h->fs_hz!=p->fs || h->scale!=p->scale){
+    if(pod_start(s,p,h)!=0){ s->rejected++; return; }
+  } else if(h->seq!=p->seq_next){ s->gaps++; p->fill=0; }   // the partial window is lost
+  p->seq_next=h->seq+1;
+  for(int i=0;i<h->n;){
+    if(p->fill==0 && p->cur<0){
+      for(int k=0;k<SERVE_SLOTS && p->cur<0;k++){ int j=(p->next+k)%SERVE_SLOTS; if(!atomic_load_explicit(&p->slot[j].busy,memory_order_acquire)) p->cur=j; }
+      if(p->cur>=0) p->next=(p->cur+1)%SERVE_SLOTS;
+    }
+    if(p->fill==0 && p->cur>=0) p->slot[p->cur].t_us = h->t_us + (uint64_t)(i*1e6/p->fs);
+    int c = h->n-i < p->W-p->fill? h->n-i : p->W-p->fill;
+    if(p->cur>=0) memcpy(p->slot[p->cur].x+p->fill, x+i, sizeof(int16_t)*c);
+    p->fill+=c; i+=c;
+    if(p->fill==p->W){
+      if(p->cur>=0){
+        ServeSlot *sl=&p->slot[p->cur];
+        sl->n=p->W; sl->fs=p->fs; sl->scale=p->scale; sl->index=p->windows; sl->t_recv=t_recv;
+        atomic_store_explicit(&sl->busy,1,memory_order_relaxed);
+        queue_push(s,(ServeItem){ (int)(p-s->pods), p->cur });
+        p->cur=-1;
+      } else s->dropped++;
+      p->windows++; p->fill=0;
+    }
+  }
+}
+
+/* ---------------- DSP workers ---------------- */
+/* Pretty record -> one line (the writer only breaks lines between members). */
+static size_t json_line(char *b, size_t n){
+  size_t o=0;
+  for(size_t i=0;i<n;i++){
+    if(b[i]=='\n'){ while(i+1<n && b[i+1]==' ') i++; continue; }
+    b[o++]=b[i];
+  }
+  b[o++]='\n';
+  return o;
+}
+
+static void *serve_worker(void *arg){
+  Serve *s=(Serve*)arg;
+  RfdContext *ctx=rfd_create(&s->cfg,&s->geom,s->pc);
+  double *acc=NULL; int acc_cap=0;
+  char *buf=NULL; size_t len=0; FILE *mf=open_memstream(&buf,&len);
+  void *xrec = s->xf? malloc(export_record_bytes(s->xf)) : NULL;
+  ServeItem it;
+  while(queue_pop(s,&it)){
+    ServePod *p=&s->pods[it.pod]; ServeSlot *sl=&p->slot[it.slot];
+    RfdWindow w={ NULL, NULL, NULL, sl->n, sl->fs, (long)p->id };
+    if(s->cfg.fixed && sl->scale==1.0f/32768.0f) w.acc_q15=sl->x;      // Q15 counts as they came
+    else {
+      if(sl->n>acc_cap){ free(acc); acc=(double*)malloc(sizeof(double)*sl->n); acc_cap=acc? sl->n : 0; }
+      if(acc) for(int i=0;i<sl->n;i++) acc[i]=sl->x[i]*(double)sl->scale;
+      w.acc=acc;
+    }
+    RfdResult r; int rc=1;
+    if(ctx && mf && (w.acc || w.acc_q15)){
+      if(s->cfg.gate){ pthread_mutex_lock(&p->lock); *rfd_gate_base(ctx)=p->gate; }
+      rc=rfd_process_window(ctx,&w,&r);
+      if(s->cfg.gate){ p->gate=*rfd_gate_base(ctx); pthread_mutex_unlock(&p->lock); }
+    }
+    StreamInfo st={ sl->index, 1, sl->t_us*1e-6 + sl->n/(double)sl->fs };
+    double t_recv=sl->t_recv;                                          // the slot is the receiver's again after the release
+    if(rc==0){ r.stream=&st; fseeko(mf,0,SEEK_SET); rfd_write_json(mf,&r); fflush(mf); }
+    if(rc==0 && s->trend){ TrendRecord tr; trend_record(&tr,&r,(int64_t)(st.t_end_s*1e6)); trend_append(s->trend,&tr); }
+    if(rc==0 && xrec){ export_pack(s->xf,&r,(int64_t)(st.t_end_s*1e6),xrec); export_write(s->xf,xrec); }
+    atomic_store_explicit(&sl->busy,0,memory_order_release);
+    pthread_mutex_lock(&s->olock);
+    if(rc==0){
+      fwrite(buf,1,json_line(buf,len),s->out); fflush(s->out);
+      double t=mono_s(); long k=s->records%SERVE_LAT;
+      s->lat[k]=t-t_recv; s->age[k]=real_s()-st.t_end_s;
+      s->records++;
+      if(s->cfg.serve_windows>0 && s->records==s->cfg.serve_windows){ uint64_t one=1; if(write(s->done_fd,&one,sizeof(one))<0){} }
+    } else s->failed++;
+    pthread_mutex_unlock(&s->olock);
+  }
+  if(mf) fclose(mf);
+  free(buf); free(acc); free(xrec); rfd_destroy(ctx);
+  return NULL;
+}
+
+/* ---------------- Stats ---------------- */
+static void serve_report(Serve *s, const char *what, double dt, long *last, double *tmp){
+  pthread_mutex_lock(&s->olock);
+  long total=s->records, n=total-*last; double lat[2], age[2];
+  lat_pct(s->lat,total,n,tmp,lat); lat_pct(s->age,total,n,tmp,age);
+  long failed=s->failed;
+  pthread_mutex_unlock(&s->olock);
+  int pods=0; for(int i=0;i<s->npods;i++) pods+=s->pods[i].used;
+  fprintf(stderr,"serve %s: %ld windows in %.1f s (%.1f windows/s) from %d pods; %ld packets, %ld bad, %ld gaps, %ld dropped, %ld rejected, %ld failed; "
+          "lat p50 %.2f ms p99 %.2f ms, age p50 %.2f ms p99 %.2f ms\n",
+          what, n, dt, dt>0.0? n/dt : 0.0, pods, s->packets, s->bad, s->gaps, s->dropped, s->rejected, failed, lat[0], lat[1], age[0], age[1]);
+  *last=total;
+}
+
+static int serve_socket(const char *spec){
+  struct sockaddr_storage sa; socklen_t len;
+  int fam=serve_addr(spec,"0.0.0.0",&sa,&len);
+  if(fam<0){ fprintf(stderr,"--serve takes udp:[host:]port or unix:path, not %s\n", spec); return -1; }
+  int fd=socket(fam,SOCK_DGRAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+  if(fd<0){ perror("serve: socket"); return -1; }
+  int rcv=8<<20; setsockopt(fd,SOL_SOCKET,SO_RCVBUF,&rcv,sizeof(rcv));   // absorbs bursts from many pods
+  if(fam==AF_UNIX) unlink(((struct sockaddr_un*)&sa)->sun_path);
+  if(bind(fd,(struct sockaddr*)&sa,len)!=0){ fprintf(stderr,"serve: cannot bind %s: %s\n", spec, strerror(errno)); close(fd); return -1; }
+  return fd;
+}
+
+int serve_run(const Config *cfg, const BearingGeom *g, FILE *out){
+  Serve *s=(Serve*)calloc(1,sizeof(Serve)); if(!s) return 1;
+  s->cfg=*cfg; s->geom=*g; s->out=out;
+  s->cfg.threads=1;                                 // parallelism is across windows
+  int workers=cfg->threads>0? cfg->threads : 1;
+  s->npods=cfg->serve_pods>0? cfg->serve_pods : 1;
+  s->pods=(ServePod*)calloc(s->npods,sizeof(ServePod));
+  s->qcap=s->npods*SERVE_SLOTS; s->q=(ServeItem*)malloc(sizeof(ServeItem)*s->qcap);
+  s->pc=rfd_cache_create();
+  if((cfg->trend_log[0] && !(s->trend=trend_open(cfg->trend_log))) || (cfg->export_file[0] && !(s->xf=export_open(cfg->export_file,cfg)))){
+    trend_close(s->trend); rfd_cache_destroy(s->pc); free(s->pods); free(s->q); free(s); return 1;
+  }
+  pthread_mutex_init(&s->qlock,NULL); pthread_cond_init(&s->qcond,NULL); pthread_mutex_init(&s->olock,NULL);
+  char *rx=(char*)malloc((size_t)SERVE_BATCH*SERVE_PKT);
+  double *tmp=(double*)malloc(sizeof(double)*SERVE_LAT);
+  int sock=serve_socket(cfg->serve), rc=1;
+  int ep=-1, tfd=-1, sfd=-1; s->done_fd=-1;
+  pthread_t *tid=(pthread_t*)calloc(workers,sizeof(pthread_t)); int started=0;
+  double t0=mono_s();
+  if(sock<0 || !s->pods || !s->q || !s->pc || !rx || !tmp || !tid) goto out;
+
+  sigset_t mask; sigemptyset(&mask); sigaddset(&mask,SIGINT); sigaddset(&mask,SIGTERM);
+  pthread_sigmask(SIG_BLOCK,&mask,NULL);            // before the workers start: they inherit it
+  sfd=signalfd(-1,&mask,SFD_CLOEXEC); s->done_fd=eventfd(0,EFD_CLOEXEC);
+  ep=epoll_create1(EPOLL_CLOEXEC);
+  if(sfd<0 || s->done_fd<0 || ep<0){ perror("serve: epoll setup"); goto out; }
+  if(cfg->serve_stats>0.0){
+    tfd=timerfd_create(CLOCK_MONOTONIC,TFD_CLOEXEC);
+    struct itimerspec its; its.it_value.tv_sec=(time_t)cfg->serve_stats; its.it_value.tv_nsec=(long)((cfg->serve_stats-(double)its.it_value.tv_sec)*1e9);
+    its.it_interval=its.it_value; timerfd_settime(tfd,0,&its,NULL);
+  }
+  int fds[4]={ sock, sfd, s->done_fd, tfd };
+  for(int k=0;k<4;k++) if(fds[k]>=0){ struct epoll_event ev={ .events=EPOLLIN, .data.fd=fds[k] }; epoll_ctl(ep,EPOLL_CTL_ADD,fds[k],&ev); }
+
+  for(; started<workers; started++) if(pthread_create(&tid[started],NULL,serve_worker,s)!=0) break;
+  fprintf(stderr,"serve: listening on %s, %d workers, windows of %.3f s\n", cfg->serve, started, cfg->duration_s);
+
+  struct mmsghdr msg[SERVE_BATCH]; struct iovec iov[SERVE_BATCH];
+  for(int k=0;k<SERVE_BATCH;k++){
+    iov[k].iov_base=rx+(size_t)k*SERVE_PKT; iov[k].iov_len=SERVE_PKT;
+    memset(&msg[k].msg_hdr,0,sizeof(msg[k].msg_hdr)); msg[k].msg_hdr.msg_iov=&iov[k]; msg[k].msg_hdr.msg_iovlen=1;
+  }
+  t0=mono_s(); double t_last=t0; long last=0; int run=1;
+  while(run){
+    struct epoll_event ev[4];
+    int n=epoll_wait(ep,ev,4,-1);
+    if(n<0){ if(errno==EINTR) continue; perror("serve: epoll_wait"); break; }
+    for(int e=0;e<n;e++){
+      int fd=ev[e].data.fd;
+      if(fd==sock){
+        int m;
+        while((m=recvmmsg(sock,msg,SERVE_BATCH,MSG_DONTWAIT,NULL))>0){
+          double t=mono_s();
+          for(int k=0;k<m;k++){
+            PodPacket h; const int16_t *x;
+            s->packets++;
+            if(packet_parse(iov[k].iov_base,msg[k].msg_len,&h,&x)!=0){ s->bad++; continue; }
+            serve_packet(s,&h,x,t);
+          }
+        }
+      } else if(fd==tfd){
+        uint64_t ticks; if(read(tfd,&ticks,sizeof(ticks))<0){}
+        double t=mono_s(); serve_report(s,"interval",t-t_last,&last,tmp); t_last=t;
+      } else run=0;                                 // signal or --serve-windows reached
+    }
+  }
+  rc=0;
+
+out:
+  pthread_mutex_lock(&s->qlock); s->stop=1; pthread_cond_broadcast(&s->qcond); pthread_mutex_unlock(&s->qlock);
+  for(int t=0;t<started;t++) pthread_join(tid[t],NULL);
+  if(rc==0){ long zero=0; serve_report(s,"total",mono_s()-t0,&zero,tmp); }
+  if(sock>=0){
+    struct sockaddr_storage sa; socklen_t len;
+    if(serve_addr(cfg->serve,"0.0.0.0",&sa,&len)==AF_UNIX) unlink(((struct sockaddr_un*)&sa)->sun_path);
+    close(sock);
+  }
+  if(ep>=0) close(ep); if(tfd>=0) close(tfd); if(sfd>=0) close(sfd); if(s->done_fd>=0) close(s->done_fd);
+  for(int i=0;s->pods && i<s->npods;i++) if(s->pods[i].used){
+    for(int k=0;k<SERVE_SLOTS;k++) free(s->pods[i].slot[k].x);
+    pthread_mutex_destroy(&s->pods[i].lock);
+  }
+  rfd_cache_destroy(s->pc); trend_close(s->trend); export_close(s->xf);
+  free(s->pods); free(s->q); free(rx); free(tmp); free(tid); free(s);
+  return rc;
+}
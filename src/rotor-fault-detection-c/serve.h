@@ -0,0 +1,43 @@
+/*
+  serve.h — rotor_fd --serve: gateway receiver for pod window packets (capture.h PodPacket)
+  Socket specs: "udp:<port>", "udp:<host>:<port>" (IPv4) or "unix:<path>" (datagram).
+*/
+#ifndef ROTOR_FD_SERVE_H
+#define ROTOR_FD_SERVE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "rotorfd.h"
+
+/* Runs until SIGINT/SIGTERM or cfg->serve_windows records; JSON lines to `out`. */
+int serve_run(const Config *cfg, const BearingGeom *g, FILE *out);
+
+/* Socket address for a spec; host defaults to `host` for udp. Returns the family or -1. */
+static inline int serve_addr(const char *spec, const char *host, struct sockaddr_storage *sa, socklen_t *len){
+  memset(sa,0,sizeof(*sa));
+  if(strncmp(spec,"unix:",5)==0){
+    struct sockaddr_un *u=(struct sockaddr_un*)sa; const char *p=spec+5;
+    if(!*p || strlen(p)>=sizeof(u->sun_path)) return -1;
+    u->sun_family=AF_UNIX; strcpy(u->sun_path,p); *len=sizeof(*u);
+    return AF_UNIX;
+  }
+  if(strncmp(spec,"udp:",4)==0){
+    struct sockaddr_in *in=(struct sockaddr_in*)sa; const char *p=spec+4, *colon=strrchr(p,':');
+    char h[64]; const char *port=p;
+    if(colon){ size_t n=(size_t)(colon-p); if(n>=sizeof(h)) return -1; memcpy(h,p,n); h[n]='\0'; host=h; port=colon+1; }
+    int pn=atoi(port); if(pn<=0 || pn>65535) return -1;
+    in->sin_family=AF_INET; in->sin_port=htons((uint16_t)pn);
+    if(inet_pton(AF_INET,host,&in->sin_addr)!=1) return -1;
+    *len=sizeof(*in);
+    return AF_INET;
+  }
+  return -1;
+}
+
+#endif
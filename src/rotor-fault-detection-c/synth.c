@@ -0,0 +1,158 @@
+/*
+  synth.c — multi-fault synthetic vibration generator (see synth.h)
+  Impact trains per fault class (rates from the bearing geometry at the current speed):
+    outer   BPFO, constant amplitude (stationary defect in the load zone)
+    inner   BPFI, amplitude following the shaft through the load zone (fr sidebands)
+    ball    2 BSF, alternately hitting both races (1, 0.5), following the cage (FTF sidebands)
+    cage    FTF
+    healthy random (Poisson) impacts at the BPFO mean rate: the same energy, no line
+  Every impact drives a two-pole resonator at fc; the impact amplitude is set from snr_db
+  with the closed-form energy of its impulse response.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "synth.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define SYN_CHUNK 256                // samples per block of constant speed
+#define SYN_KEY_NOISE  0x6e6f697365ull
+#define SYN_KEY_IMPACT 0x696d70616374ull
+
+const char *const synth_fault[SYN_CLASSES]={ "healthy", "outer_race", "inner_race", "ball", "cage" };
+
+/* Counter-based RNG: splitmix64's finalizer over key + counter. */
+static inline uint64_t syn_mix(uint64_t z){
+  z+=0x9e3779b97f4a7c15ull;
+  z=(z^(z>>30))*0xbf58476d1ce4e5b9ull; z=(z^(z>>27))*0x94d049bb133111ebull;
+  return z^(z>>31);
+}
+
+/* Irwin-Hall sum of the eight 16-bit halves of two hashes: unit variance, kurtosis 2.85
+   (Gaussian 3), no log/cos, so loops over it vectorize. */
+static inline double syn_gauss(uint64_t key, uint64_t ctr){
+  uint64_t h0=syn_mix(key+2*ctr), h1=syn_mix(key+2*ctr+1);
+  uint32_t s=(uint32_t)(h0&0xffff) + (uint32_t)((h0>>16)&0xffff) + (uint32_t)((h0>>32)&0xffff) + (uint32_t)(h0>>48)
+           + (uint32_t)(h1&0xffff) + (uint32_t)((h1>>16)&0xffff) + (uint32_t)((h1>>32)&0xffff) + (uint32_t)(h1>>48);
+  return ((double)(int32_t)s - 8*32767.5) * (1.0/(65536.0*0.816496580927726));   // sd of the sum: 65536 sqrt(8/12)
+}
+
+double synth_uniform(uint64_t key, uint64_t ctr){ return ((syn_mix(key+ctr)>>11)+0.5) * (1.0/9007199254740992.0); }
+
+static double geo_ratio(const BearingGeom *g){ return (g->d/g->D)*cos(g->beta); }
+
+/* Impacts per second at speed rpm. */
+static double impact_hz(const SynthSpec *s, double rpm){
+  double fr=rpm/60.0, r=geo_ratio(&s->g);
+  switch(s->fault){
+    case SYN_INNER: return 0.5*s->g.n*fr*(1.0+r);
+    case SYN_BALL:  return 2.0*(s->g.D/(2.0*s->g.d))*fr*(1.0-r*r);
+    case SYN_CAGE:  return 0.5*fr*(1.0-r);
+    default:        return 0.5*s->g.n*fr*(1.0-r);   // outer, healthy
+  }
+}
+
+double synth_line_hz(const SynthSpec *s, double rpm){
+  if(s->fault==SYN_HEALTHY) return 0.0;
+  return s->fault==SYN_BALL? 0.5*impact_hz(s,rpm) : impact_hz(s,rpm);
+}
+
+const char *synth_expected(int fault){ return fault==SYN_HEALTHY? "unknown" : synth_fault[fault]; }
+
+void synth_defaults(SynthSpec *s){
+  memset(s,0,sizeof(*s));
+  Config c; rfd_defaults(&c,&s->g);
+  s->fault=SYN_OUTER; s->fs=c.fs; s->rpm0=s->rpm1=s->g.rpm; s->seconds=c.duration_s;
+  s->snr_db=-6.0; s->fc=6000.0; s->zeta=0.03; s->slip=0.01; s->shaft=0.5; s->noise_rms=0.05; s->seed=1;
+}
+
+int synth_parse(SynthSpec *s, const char *spec){
+  char buf[512]; strncpy(buf,spec,sizeof(buf)-1); buf[sizeof(buf)-1]='\0';
+  char *save=NULL;
+  for(char *tok=strtok_r(buf,",",&save); tok; tok=strtok_r(NULL,",",&save)){
+    char *eq=strchr(tok,'='); if(!eq){ fprintf(stderr,"--synth: expected key=value, got %s\n", tok); return -1; }
+    *eq='\0'; const char *k=tok, *v=eq+1;
+    if(strcmp(k,"fault")==0){
+      int f=-1;
+      for(int j=0;j<SYN_CLASSES;j++) if(strcmp(v,synth_fault[j])==0 || strncmp(v,synth_fault[j],strlen(v))==0) { f=j; break; }
+      if(f<0 || !v[0]){ fprintf(stderr,"--synth: unknown fault %s (healthy, outer, inner, ball, cage)\n", v); return -1; }
+      s->fault=f;
+    }
+    else if(strcmp(k,"rpm")==0) s->rpm0=s->rpm1=atof(v);
+    else if(strcmp(k,"rpm0")==0) s->rpm0=atof(v);
+    else if(strcmp(k,"rpm1")==0) s->rpm1=atof(v);
+    else if(strcmp(k,"snr")==0) s->snr_db=atof(v);
+    else if(strcmp(k,"fc")==0) s->fc=atof(v);
+    else if(strcmp(k,"zeta")==0) s->zeta=atof(v);
+    else if(strcmp(k,"slip")==0) s->slip=atof(v)/100.0;
+    else if(strcmp(k,"shaft")==0) s->shaft=atof(v);
+    else if(strcmp(k,"noise")==0) s->noise_rms=atof(v);
+    else if(strcmp(k,"seed")==0) s->seed=strtoull(v,NULL,0);
+    else { fprintf(stderr,"--synth: unknown key %s\n", k); return -1; }
+  }
+  if(s->rpm0<=0.0 || s->rpm1<=0.0 || !(s->fc>0.0 && s->fc<0.5*s->fs) || !(s->zeta>0.0 && s->zeta<1.0) || s->slip<0.0 || s->noise_rms<0.0){
+    fprintf(stderr,"--synth: rpm, fc (below Nyquist), zeta (0..1), slip and noise out of range\n"); return -1;
+  }
+  return 0;
+}
+
+/* Next impact interval in fault periods: Gaussian slip, or exponential for random impacts. */
+static double next_interval(const SynthGen *g){
+  if(g->s.fault==SYN_HEALTHY) return -log(synth_uniform(g->s.seed^SYN_KEY_IMPACT,g->impacts));
+  double u=1.0 + g->s.slip*syn_gauss(g->s.seed^SYN_KEY_IMPACT,g->impacts);
+  return u<0.1? 0.1 : u;
+}
+
+void synth_init(SynthGen *g, const SynthSpec *s){
+  memset(g,0,sizeof(*g)); g->s=*s;
+  double w0=2.0*M_PI*s->fc/s->fs, r=exp(-s->zeta*w0), wd=w0*sqrt(1.0-s->zeta*s->zeta);
+  g->a1=2.0*r*cos(wd); g->a2=r*r;
+  g->x0=sin(wd);                      // impulse input giving a unit peak response
+  // sum r^2n sin^2((n+1) wd): energy of that response
+  double q=r*r, c=cos(2.0*wd), e=0.5*(1.0/(1.0-q) - (c-q)/(1.0-2.0*q*c+q*q));
+  double mod2 = s->fault==SYN_INNER? 0.375 : s->fault==SYN_BALL? 0.375*0.625 : 1.0;   // mean square of the amplitude modulation
+  double rate=impact_hz(s,0.5*(s->rpm0+s->rpm1))/s->fs;
+  g->amp = rate>0.0? s->noise_rms*sqrt(pow(10.0,s->snr_db/10.0)/(rate*e*mod2)) : 0.0;
+  g->next=next_interval(g);
+}
+
+void synth_block(SynthGen *g, double *acc, double *tach, int n){
+  const SynthSpec *s=&g->s;
+  uint64_t key=s->seed^SYN_KEY_NOISE;
+  for(int c0=0;c0<n;c0+=SYN_CHUNK){
+    int m = n-c0<SYN_CHUNK? n-c0 : SYN_CHUNK;
+    double *a=acc+c0;
+    for(int i=0;i<m;i++) a[i]=s->noise_rms*syn_gauss(key,g->n+(uint64_t)i);
+
+    double t=(g->n+0.5*m)/s->fs, rpm=s->rpm0+(s->rpm1-s->rpm0)*fmin(t/s->seconds,1.0);
+    double dsh=rpm/60.0/s->fs, dfa=impact_hz(s,rpm)/s->fs, dcg=0.5*(1.0-geo_ratio(&s->g))*dsh;
+    double c1=cos(2*M_PI*dsh), s1=sin(2*M_PI*dsh), c2=c1*c1-s1*s1, s2=2.0*s1*c1;
+    double z1r=cos(2*M_PI*g->shaft_ph), z1i=sin(2*M_PI*g->shaft_ph), z2r=z1r*z1r-z1i*z1i, z2i=2.0*z1r*z1i;   // resynced every chunk
+    double A=s->shaft*s->noise_rms, y1=g->y1, y2=g->y2;
+    for(int i=0;i<m;i++){
+      double x=0.0;
+      g->fault_ph+=dfa;
+      if(g->fault_ph>=g->next){
+        double w=1.0;
+        if(s->fault==SYN_INNER) w=0.5+0.5*cos(2*M_PI*g->shaft_ph);
+        else if(s->fault==SYN_BALL) w=(g->impacts&1? 0.5 : 1.0)*(0.5+0.5*cos(2*M_PI*g->cage_ph));
+        x=g->amp*g->x0*w; g->fault_ph-=g->next; g->impacts++; g->next=next_interval(g);
+      }
+      double y=g->a1*y1 - g->a2*y2 + x; y2=y1; y1=y;
+      a[i]+=y + A*(z1i + 0.5*z2i);
+      double r1=z1r*c1-z1i*s1; z1i=z1r*s1+z1i*c1; z1r=r1;
+      double r2=z2r*c2-z2i*s2; z2i=z2r*s2+z2i*c2; z2r=r2;
+      g->shaft_ph+=dsh; if(g->shaft_ph>=1.0) g->shaft_ph-=1.0;
+      g->cage_ph+=dcg;  if(g->cage_ph>=1.0) g->cage_ph-=1.0;
+      if(tach) tach[c0+i] = g->shaft_ph<0.5? 0.0 : 1.0;
+    }
+    g->y1=y1; g->y2=y2; g->n+=(uint64_t)m;
+  }
+}
@@ -0,0 +1,63 @@
+/*
+  synth.h — multi-fault synthetic vibration generator (rotor_synth, rotor_fd --synth)
+  - Outer race, inner race, ball and cage faults as trains of impacts, each ringing a
+    structural resonance; a healthy machine gets the same impacts at random times
+  - Speed ramps linearly over the capture; the tach, shaft tones and fault rates follow it
+  - Slip: every impact interval is jittered by a Gaussian fraction of itself
+  - Noise comes from a counter-based RNG (sample index -> hash), so any block of any
+    capture can be produced on its own and the noise loop vectorizes; tones and the
+    resonance are recurrences (rotating phasors, a two-pole filter), with no per-sample
+    sin/pow calls
+  A capture is produced block by block from a SynthGen, so it can be streamed.
+*/
+#ifndef ROTOR_FD_SYNTH_H
+#define ROTOR_FD_SYNTH_H
+
+#include <stdint.h>
+
+#include "rotorfd.h"
+
+enum { SYN_HEALTHY, SYN_OUTER, SYN_INNER, SYN_BALL, SYN_CAGE, SYN_CLASSES };   // numbered as TREND_*
+
+typedef struct {
+  int      fault;         // SYN_*
+  BearingGeom g;          // geometry (g.rpm is not used: rpm0 / rpm1)
+  double   fs;
+  double   rpm0, rpm1;    // shaft speed at the start and end of the capture (linear ramp)
+  double   seconds;       // ramp length
+  double   snr_db;        // power of the impacts over the broadband noise
+  double   fc, zeta;      // resonance rung by each impact [Hz], damping ratio
+  double   slip;          // sd of each impact interval, as a fraction of it
+  double   shaft;         // 1x and 2x shaft tone amplitude / noise rms
+  double   noise_rms;     // broadband noise level (physical units)
+  uint64_t seed;
+} SynthSpec;
+
+typedef struct {
+  SynthSpec s;
+  uint64_t n;             // samples produced
+  double   shaft_ph, cage_ph, fault_ph, next;   // revolutions / fault periods
+  double   a1, a2, x0, y1, y2;                  // resonator
+  double   amp;           // impact amplitude from snr_db
+  uint64_t impacts;
+} SynthGen;
+
+extern const char *const synth_fault[SYN_CLASSES];   // "healthy", "outer_race", ...
+
+void   synth_defaults(SynthSpec *s);
+/* "k=v,k=v": fault=outer|inner|ball|cage|healthy, rpm, rpm0, rpm1, snr, fc, zeta, slip,
+   shaft, noise, seed. -1 on an unknown key or value. */
+int    synth_parse(SynthSpec *s, const char *spec);
+/* Fault line at speed rpm [Hz]: the one the detector should find (0 when healthy). */
+double synth_line_hz(const SynthSpec *s, double rpm);
+/* Decision the detector should reach: synth_fault name, "unknown" for a healthy machine. */
+const char *synth_expected(int fault);
+
+/* Uniform in (0,1) from the generator's counter-based RNG (for drawing scenarios). */
+double synth_uniform(uint64_t key, uint64_t ctr);
+
+void   synth_init(SynthGen *g, const SynthSpec *s);
+/* Next n samples; tach (square wave, rising once per revolution) may be NULL. */
+void   synth_block(SynthGen *g, double *acc, double *tach, int n);
+
+#endif
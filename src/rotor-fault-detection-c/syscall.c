@@ -75,8 +75,9 @@ int _getpid(void) {
 extern uint8_t _end;     // end of .bss/.data
 extern uint8_t _estack;  // top of stack
 
+static uint8_t *heap_end;
+
 void *_sbrk(ptrdiff_t incr) {
-  static uint8_t *heap_end;
   uint8_t *prev_heap_end;
 
   if (heap_end == NULL) heap_end = &_end;
@@ -92,3 +93,8 @@ void *_sbrk(ptrdiff_t incr) {
   heap_end += incr;
   return (void *)prev_heap_end;
 }
+
+// Heap high-water mark for --profile (perf_dwt.c); _sbrk never gives memory back.
+size_t sbrk_heap_bytes(void) {
+  return heap_end ? (size_t)(heap_end - &_end) : 0;
+}
@@ -0,0 +1,250 @@
+/*
+  trend.c — append-only trend log and its asset/time index (see trend.h)
+*/
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE   // flock
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trend.h"
+
+#define TREND_GROW 256                  // index blocks added per remap
+
+typedef struct {
+  uint32_t magic; uint16_t version, header_bytes;
+  uint32_t record_bytes; uint8_t reserved[52];
+} TrendLogHeader;
+
+typedef struct {
+  uint32_t magic; uint16_t version, header_bytes;
+  uint32_t assets, block_bytes;
+  uint64_t records;                     // log records already indexed
+  uint64_t blocks;
+  uint8_t  reserved[32];
+} TrendIdxHeader;
+
+typedef struct {
+  uint32_t asset, n;
+  int64_t  t_first, t_last;             // min / max t_us of the entries
+  uint64_t prev;                        // older block + 1 (0: none)
+  uint64_t rec[TREND_BLOCK];
+} TrendBlock;
+
+_Static_assert(sizeof(TrendLogHeader)==TREND_HEADER_BYTES, "trend log header must be 64 bytes");
+_Static_assert(sizeof(TrendIdxHeader)==TREND_HEADER_BYTES, "trend index header must be 64 bytes");
+_Static_assert(sizeof(TrendBlock)==512, "TrendBlock must be 512 bytes");
+
+#define IDX_BLOCKS_AT ((size_t)TREND_HEADER_BYTES + sizeof(TrendAsset)*TREND_ASSETS)
+
+struct TrendStore {
+  int log_fd, idx_fd;
+  char *idx; size_t idx_len;            // shared mapping of the index file
+  const char *log; size_t log_len;      // read-only mapping of the log for scans, grown on demand
+  pthread_mutex_t lock;                 // appends from several threads (--serve), scans
+};
+
+const char *const trend_feature[TREND_NF]={ "rms", "peak", "crest", "kurtosis",
+  "band_0.25x", "band_0.5x", "band_1x", "band_2x", "band_4x", "band_8x", "band_16x", "band_32x" };
+const char *const trend_fault[TREND_FAULTS]={ "unknown", "outer_race", "inner_race", "ball", "cage" };
+
+static TrendIdxHeader *idx_hdr(const TrendStore *t){ return (TrendIdxHeader*)t->idx; }
+static TrendAsset *idx_assets(const TrendStore *t){ return (TrendAsset*)(t->idx + TREND_HEADER_BYTES); }
+static TrendBlock *idx_block(const TrendStore *t, uint64_t b){ return (TrendBlock*)(t->idx + IDX_BLOCKS_AT + b*sizeof(TrendBlock)); }
+
+uint32_t trend_asset_id(long pod_id, const char *name){
+  if(pod_id>=0) return (uint32_t)pod_id;
+  uint32_t h=2166136261u; for(const char *p=name; *p; p++){ h^=(uint8_t)*p; h*=16777619u; }
+  return h;
+}
+
+/* Octave bands of the envelope spectrum in shaft orders: band k = [fr 2^(k-2), fr 2^(k-1)). */
+static void trend_bands(float *out, const double *f, const double *P, int K, double fr){
+  for(int k=0;k<TREND_BANDS;k++) out[k]=NAN;
+  if(!f || K<2 || fr<=0.0) return;
+  double df=f[1]-f[0], sum[TREND_BANDS]={0}; int hit[TREND_BANDS]={0};
+  for(int i=1;i<K;i++){
+    int k=(int)floor(log2(f[i]/fr))+2;
+    if(k>=0 && k<TREND_BANDS){ sum[k]+=P[i]*df; hit[k]=1; }
+  }
+  for(int k=0;k<TREND_BANDS;k++) if(hit[k] && sum[k]>0.0) out[k]=(float)(10.0*log10(sum[k]));
+}
+
+void trend_record(TrendRecord *rec, const RfdResult *r, int64_t t_us){
+  memset(rec,0,sizeof(*rec));
+  if(!t_us){ struct timespec ts; clock_gettime(CLOCK_REALTIME,&ts); t_us=(int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000; }
+  const Detections *d=&r->det;
+  rec->t_us=t_us; rec->asset=trend_asset_id(r->cfg->pod_id,r->cfg->name);
+  for(int k=1;k<TREND_FAULTS;k++) if(strcmp(d->fault,trend_fault[k])==0) rec->fault=(uint16_t)k;
+  rec->flags = (r->gate && !r->gate->run_full? TREND_GATED : 0) | (r->cfg->fixed? TREND_FIXED : 0) | (r->order? TREND_ORDER : 0);
+  rec->conf=(float)d->conf; rec->fr=(float)d->fr;
+  const PeakHit *h[4]={ &d->hz_bpfo, &d->hz_bpfi, &d->hz_bsf, &d->hz_ftf };
+  for(int k=0;k<4;k++) if(h[k]->found){ rec->freq[k]=(float)h[k]->freq; rec->snr_db[k]=(float)h[k]->snr_db; }
+  for(int k=0;k<GATE_NF;k++) rec->f[k] = r->features? (float)r->features[k] : NAN;
+  trend_bands(rec->f+GATE_NF,r->f_hz,r->psd,r->bins,d->fr);
+}
+
+/* Maps at least `need` bytes of the index, growing the file if it is shorter. */
+static int idx_map(TrendStore *t, size_t need){
+  if(t->idx && need<=t->idx_len) return 0;
+  struct stat st; if(fstat(t->idx_fd,&st)!=0) return -1;
+  size_t len=(size_t)st.st_size;
+  if(len<need){ len=need + TREND_GROW*sizeof(TrendBlock); if(ftruncate(t->idx_fd,(off_t)len)!=0) return -1; }
+  if(t->idx) munmap(t->idx,t->idx_len);
+  void *p=mmap(NULL,len,PROT_READ|PROT_WRITE,MAP_SHARED,t->idx_fd,0);
+  if(p==MAP_FAILED){ t->idx=NULL; t->idx_len=0; return -1; }
+  t->idx=(char*)p; t->idx_len=len;
+  return 0;
+}
+
+static TrendAsset *asset_slot(TrendStore *t, uint32_t asset, int add){
+  TrendAsset *tab=idx_assets(t);
+  for(int k=0;k<TREND_ASSETS;k++){
+    TrendAsset *a=&tab[(asset*2654435761u + (uint32_t)k) % TREND_ASSETS];
+    if(a->used && a->asset==asset) return a;
+    if(!a->used){ if(!add) return NULL; a->used=1; a->asset=asset; a->t_first=INT64_MAX; a->t_last=INT64_MIN; return a; }
+  }
+  return NULL;
+}
+
+/* Index entry + baseline update for log record `no`. */
+static int idx_add(TrendStore *t, const TrendRecord *rec, uint64_t no){
+  TrendAsset *a=asset_slot(t,rec->asset,1);
+  if(!a) return -1;                                   // table full: the record stays in the log only
+  TrendBlock *b = a->head? idx_block(t,a->head-1) : NULL;
+  if(!b || b->n==TREND_BLOCK){
+    uint64_t nb=idx_hdr(t)->blocks;
+    if(idx_map(t,IDX_BLOCKS_AT+(nb+1)*sizeof(TrendBlock))!=0) return -1;
+    a=asset_slot(t,rec->asset,0);                     // the mapping may have moved
+    b=idx_block(t,nb); memset(b,0,sizeof(*b));
+    b->asset=rec->asset; b->prev=a->head; b->t_first=INT64_MAX; b->t_last=INT64_MIN;
+    a->head=nb+1; idx_hdr(t)->blocks=nb+1;
+  }
+  b->rec[b->n++]=no;
+  if(rec->t_us<b->t_first) b->t_first=rec->t_us;
+  if(rec->t_us>b->t_last) b->t_last=rec->t_us;
+  a->windows++;
+  if(rec->t_us<a->t_first) a->t_first=rec->t_us;
+  if(rec->t_us>a->t_last) a->t_last=rec->t_us;
+  if(rec->fault<TREND_FAULTS) a->faults[rec->fault]++;
+  if(rec->fault==TREND_UNKNOWN) for(int k=0;k<TREND_NF;k++){
+    double x=rec->f[k]; if(isnan(x)) continue;
+    a->n[k]++; double d=x-a->mean[k]; a->mean[k]+=d/a->n[k]; a->m2[k]+=d*(x-a->mean[k]);
+  }
+  return 0;
+}
+
+static long log_count(const TrendStore *t){
+  struct stat st; if(fstat(t->log_fd,&st)!=0 || st.st_size<TREND_HEADER_BYTES) return 0;
+  return (long)((st.st_size-TREND_HEADER_BYTES)/(off_t)sizeof(TrendRecord));
+}
+
+/* Indexes log records written by another process or lost to a crash (index lock held). */
+static void idx_catch_up(TrendStore *t){
+  long n=log_count(t);
+  if(idx_map(t,IDX_BLOCKS_AT+idx_hdr(t)->blocks*sizeof(TrendBlock))!=0) return;
+  for(uint64_t i=idx_hdr(t)->records; i<(uint64_t)n; i++){
+    TrendRecord rec;
+    if(pread(t->log_fd,&rec,sizeof(rec),(off_t)(TREND_HEADER_BYTES+i*sizeof(TrendRecord)))!=(ssize_t)sizeof(rec)) break;
+    idx_add(t,&rec,i); idx_hdr(t)->records=i+1;
+  }
+}
+
+static int open_header(int fd, uint32_t magic){
+  struct stat st; if(fstat(fd,&st)!=0) return -1;
+  if(st.st_size==0){
+    char h[TREND_HEADER_BYTES]; memset(h,0,sizeof(h));
+    if(magic==TREND_MAGIC){ TrendLogHeader *l=(TrendLogHeader*)h; l->magic=magic; l->version=TREND_VERSION; l->header_bytes=TREND_HEADER_BYTES; l->record_bytes=sizeof(TrendRecord); }
+    else { TrendIdxHeader *x=(TrendIdxHeader*)h; x->magic=magic; x->version=TREND_VERSION; x->header_bytes=TREND_HEADER_BYTES; x->assets=TREND_ASSETS; x->block_bytes=sizeof(TrendBlock); }
+    if(pwrite(fd,h,sizeof(h),0)!=(ssize_t)sizeof(h)) return -1;
+  }
+  uint32_t m; if(pread(fd,&m,sizeof(m),0)!=(ssize_t)sizeof(m) || m!=magic) return -1;
+  return 0;
+}
+
+TrendStore *trend_open(const char *path){
+  char ipath[1024]; snprintf(ipath,sizeof(ipath),"%s.idx",path);
+  TrendStore *t=(TrendStore*)calloc(1,sizeof(TrendStore)); if(!t) return NULL;
+  t->log_fd=open(path,O_RDWR|O_CREAT,0644); t->idx_fd=open(ipath,O_RDWR|O_CREAT,0644);
+  if(t->log_fd<0 || t->idx_fd<0){ fprintf(stderr,"Cannot open trend log %s\n", path); trend_close(t); return NULL; }
+  flock(t->idx_fd,LOCK_EX);
+  int ok = open_header(t->log_fd,TREND_MAGIC)==0 && open_header(t->idx_fd,TREND_IDX_MAGIC)==0
+        && idx_map(t,IDX_BLOCKS_AT)==0;
+  if(ok){ TrendIdxHeader *h=idx_hdr(t); ok = h->assets==TREND_ASSETS && h->block_bytes==sizeof(TrendBlock); }
+  if(ok) idx_catch_up(t);
+  flock(t->idx_fd,LOCK_UN);
+  if(!ok){ fprintf(stderr,"%s is not a rotor_fd trend log (or its index is damaged; delete %s to rebuild)\n", path, ipath); trend_close(t); return NULL; }
+  pthread_mutex_init(&t->lock,NULL);
+  return t;
+}
+
+void trend_close(TrendStore *t){
+  if(!t) return;
+  if(t->idx) munmap(t->idx,t->idx_len);
+  if(t->log) munmap((void*)t->log,t->log_len);
+  if(t->log_fd>=0) close(t->log_fd);
+  if(t->idx_fd>=0) close(t->idx_fd);
+  pthread_mutex_destroy(&t->lock);
+  free(t);
+}
+
+int trend_append(TrendStore *t, const TrendRecord *rec){
+  pthread_mutex_lock(&t->lock); flock(t->idx_fd,LOCK_EX);
+  idx_catch_up(t);
+  uint64_t no=(uint64_t)log_count(t);
+  int rc = pwrite(t->log_fd,rec,sizeof(*rec),(off_t)(TREND_HEADER_BYTES+no*sizeof(TrendRecord)))==(ssize_t)sizeof(*rec)? 0 : -1;
+  if(rc==0 && idx_hdr(t)->records==no){ idx_add(t,rec,no); idx_hdr(t)->records=no+1; }
+  flock(t->idx_fd,LOCK_UN); pthread_mutex_unlock(&t->lock);
+  return rc;
+}
+
+long trend_records(const TrendStore *t){ return (long)idx_hdr(t)->records; }
+
+int trend_assets(const TrendStore *t, const TrendAsset **list, int max){
+  int n=0; const TrendAsset *tab=idx_assets(t);
+  for(int k=0;k<TREND_ASSETS && n<max;k++) if(tab[k].used) list[n++]=&tab[k];
+  return n;
+}
+
+const TrendAsset *trend_asset(const TrendStore *t, uint32_t asset){ return asset_slot((TrendStore*)t,asset,0); }
+
+long trend_scan(TrendStore *t, uint32_t asset, int64_t t0, int64_t t1,
+                void (*fn)(const TrendRecord *rec, void *ctx), void *ctx){
+  pthread_mutex_lock(&t->lock); flock(t->idx_fd,LOCK_SH);
+  const TrendAsset *a = idx_map(t,IDX_BLOCKS_AT+idx_hdr(t)->blocks*sizeof(TrendBlock))==0? asset_slot(t,asset,0) : NULL;
+  if(!a || !a->head || t0>a->t_last || t1<a->t_first){ flock(t->idx_fd,LOCK_UN); pthread_mutex_unlock(&t->lock); return 0; }
+  size_t len=TREND_HEADER_BYTES + idx_hdr(t)->records*sizeof(TrendRecord);
+  if(len>t->log_len){                     // the log only grows: remap once it outruns the mapping
+    if(t->log) munmap((void*)t->log,t->log_len);
+    void *map=mmap(NULL,len,PROT_READ,MAP_SHARED,t->log_fd,0);
+    t->log = map==MAP_FAILED? NULL : (const char*)map; t->log_len = t->log? len : 0;
+  }
+  if(!t->log){ flock(t->idx_fd,LOCK_UN); pthread_mutex_unlock(&t->lock); return -1; }
+  const TrendRecord *log=(const TrendRecord*)(t->log + TREND_HEADER_BYTES);
+  int cap=64, nb=0; uint64_t *chain=(uint64_t*)malloc(sizeof(uint64_t)*cap);
+  for(uint64_t b=a->head; b; b=idx_block(t,b-1)->prev){         // newest to oldest
+    const TrendBlock *blk=idx_block(t,b-1);
+    if(blk->t_last<t0 || blk->t_first>t1) continue;
+    if(nb==cap){ cap*=2; chain=(uint64_t*)realloc(chain,sizeof(uint64_t)*cap); }
+    chain[nb++]=b-1;
+  }
+  long hits=0;
+  for(int i=nb-1;i>=0;i--){
+    const TrendBlock *blk=idx_block(t,chain[i]);
+    for(uint32_t j=0;j<blk->n;j++){
+      const TrendRecord *r=&log[blk->rec[j]];
+      if(r->t_us>=t0 && r->t_us<=t1){ fn(r,ctx); hits++; }
+    }
+  }
+  free(chain); flock(t->idx_fd,LOCK_UN); pthread_mutex_unlock(&t->lock);
+  return hits;
+}
@@ -0,0 +1,77 @@
+/*
+  trend.h — append-only trend log for rotor_fd records (--trend-log, --trend)
+  - <path>: 64-byte header + fixed 128-byte TrendRecord per window, appended under flock
+  - <path>.idx: mmap-able index. A hashed asset table (window count, time span, Welford
+    baseline of every feature) followed by 512-byte blocks of record numbers, chained
+    newest to oldest per asset, so a query touches only that asset's records in range
+  - Baselines move in O(1) per window and leave out windows with a fault decision
+  An index behind the log (crash between the two writes, or a deleted .idx) is caught up
+  from the log on open.
+*/
+#ifndef ROTOR_FD_TREND_H
+#define ROTOR_FD_TREND_H
+
+#include <stdint.h>
+
+#include "rotorfd.h"
+
+#define TREND_MAGIC      0x54444652u   // "RFDT"
+#define TREND_IDX_MAGIC  0x49444652u   // "RFDI"
+#define TREND_VERSION    1
+#define TREND_HEADER_BYTES 64
+#define TREND_ASSETS     256           // index table slots (assets per log)
+#define TREND_BLOCK      60            // record numbers per index block
+#define TREND_BANDS      8             // envelope octave bands from fr/4 to 64 fr
+#define TREND_NF         (GATE_NF + TREND_BANDS)
+
+enum { TREND_UNKNOWN, TREND_OUTER, TREND_INNER, TREND_BALL, TREND_CAGE, TREND_FAULTS };
+enum { TREND_GATED=1, TREND_FIXED=2, TREND_ORDER=4 };
+
+typedef struct {
+  int64_t  t_us;          // window end (unix us)
+  uint32_t asset;         // pod id, or FNV-1a of the run name when there is none
+  uint16_t fault;         // TREND_OUTER .. (TREND_UNKNOWN: no decision)
+  uint16_t flags;         // TREND_GATED | TREND_FIXED | TREND_ORDER
+  float    conf;
+  float    fr;            // shaft rate [Hz]
+  float    freq[4];       // detected BPFO, BPFI, BSF, FTF [Hz] (0: not found)
+  float    snr_db[4];
+  float    f[TREND_NF];   // rms, peak, crest, kurtosis, band powers [dB]; NaN when not measured
+  uint8_t  reserved[24];
+} TrendRecord;
+
+_Static_assert(sizeof(TrendRecord)==128, "TrendRecord must be 128 bytes");
+
+typedef struct {
+  uint32_t asset, used;
+  int64_t  windows, t_first, t_last;
+  uint64_t head;          // newest index block + 1 (0: none)
+  uint32_t faults[TREND_FAULTS];
+  uint32_t pad;
+  int64_t  n[TREND_NF];   // Welford baseline per feature (healthy windows only)
+  double   mean[TREND_NF], m2[TREND_NF];
+} TrendAsset;
+
+typedef struct TrendStore TrendStore;
+
+extern const char *const trend_feature[TREND_NF];
+extern const char *const trend_fault[TREND_FAULTS];
+
+uint32_t trend_asset_id(long pod_id, const char *name);
+/* Record for a processed window; t_us 0 stamps the current time. */
+void trend_record(TrendRecord *rec, const RfdResult *r, int64_t t_us);
+
+TrendStore *trend_open(const char *path);   // creates both files; NULL on error
+void trend_close(TrendStore *t);
+int  trend_append(TrendStore *t, const TrendRecord *rec);   // thread-safe
+long trend_records(const TrendStore *t);
+
+/* Asset table entries in use (n returned); one asset, NULL if unknown. */
+int  trend_assets(const TrendStore *t, const TrendAsset **list, int max);
+const TrendAsset *trend_asset(const TrendStore *t, uint32_t asset);
+/* Calls fn on every record of `asset` with t0 <= t_us <= t1, in append order; returns the
+   count. Entries from trend_assets() may move when a scan remaps the index: re-fetch them. */
+long trend_scan(TrendStore *t, uint32_t asset, int64_t t0, int64_t t1,
+                void (*fn)(const TrendRecord *rec, void *ctx), void *ctx);
+
+#endif